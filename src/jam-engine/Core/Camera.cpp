@@ -20,7 +20,7 @@ Camera::Camera(Level *level, float maxSpeed, float acceleration, const sf::Rect<
 {
 	level->registerCamera(this);
 	//	by default, make the view the size of the window
-	view.setSize(sf::Vector2f(level->getGame().getWindow().getSize()));
+	view.setSize(sf::Vector2f(level->getGame().getScreenSize()));
 	//	by default, make the view take up the window
 	view.setViewport(sf::FloatRect(0.f, 0.f, 1.f, 1.f));
 }
@@ -3,10 +3,14 @@
 #include "jam-engine/Core/Game.hpp"
 #include "jam-engine/Core/Level.hpp"
 #include "jam-engine/Physics/PolygonMask.hpp"
+#include "jam-engine/Physics/SpatialHash.hpp"
 
 namespace je
 {
 
+//	the Entity whose update() is running on this thread, which is the only mask it may touch during a parallel update
+static thread_local Entity *updatingEntity = nullptr;
+
 Entity::Entity(Level * const level, const Type& type, const sf::Vector2f& startPos, const sf::Vector2i& dim, const sf::Vector2i offset)
 	:level(level)
 	,type(type)
@@ -19,7 +23,14 @@ Entity::Entity(Level * const level, const Type& type, const sf::Vector2f& startP
 	,collisionMask(std::move(DetailedMask::MaskRef(new PolygonMask(dim.x, dim.y))))
 	,transformable()
 	,isTransformValid(true)
-	,ref(new bool(true))
+	,handle(level->handles.allocate(this))
+	,lastTickPos(startPos)
+	,broadphase(nullptr)
+	,broadphaseCells()
+	,broadphaseIndex(0)
+	,depthBucket(nullptr)
+	,depthBucketKey(0)
+	,depthBucketIndex(0)
 {
 	transform().setPosition(startPos);
 	transform().setOrigin(-offset.x, -offset.y);
@@ -44,7 +55,14 @@ Entity::Entity(Level * const level, const Type& type, const sf::Vector2f& startP
 	,collisionMask(std::move(mask))
 	,transformable()
 	,isTransformValid(true)
-	,ref(new bool(true))
+	,handle(level->handles.allocate(this))
+	,lastTickPos(startPos)
+	,broadphase(nullptr)
+	,broadphaseCells()
+	,broadphaseIndex(0)
+	,depthBucket(nullptr)
+	,depthBucketKey(0)
+	,depthBucketIndex(0)
 {
 	transform().setPosition(startPos);
 #ifdef JE_DEBUG
@@ -56,7 +74,23 @@ Entity::Entity(Level * const level, const Type& type, const sf::Vector2f& startP
 
 Entity::~Entity()
 {
-	*ref = false;
+	//	already released if the Level removed this in a batch
+	if (handle.table)
+		level->handles.release(handle);
+	if (broadphase)
+		broadphase->remove(*this);
+	if (depthBucket)
+		level->removeFromDepthBuckets(*this);
+}
+
+void* Entity::operator new(std::size_t size)
+{
+	return EntityPool::allocateUnpooled(size);
+}
+
+void Entity::operator delete(void *ptr)
+{
+	EntityPool::release(ptr);
 }
 
 #ifdef JE_DEBUG
@@ -79,23 +113,42 @@ void Entity::debugDraw(sf::RenderTarget& target)
 }
 #endif
 
+bool Entity::drawBatched(SpriteBatch& batch) const
+{
+	return false;
+}
+
+sf::Rect<int> Entity::getDrawBounds() const
+{
+	return collisionMask.getAABB();
+}
+
 void Entity::update()
 {
+	Entity *const outer = updatingEntity;
+	updatingEntity = this;
+	lastTickPos = getPos();
 	this->updateMask();
 	this->onUpdate();
 
-	for (const std::string typeName : autoCollisionChecks)
+	for (const Type& type : autoCollisionChecks)
 	{
-		if (level->testCollision(this, typeName, 0, 0))
+		if (level->testCollision(this, type, 0, 0))
 		{
 			transform().setPosition(prevPos);
 			break;
 		}
 	}
 	prevPos = getPos();
+	//	keep the broadphase in sync with wherever onUpdate() left us
+	this->updateMask();
+	//	catches subclasses assigning to depth directly instead of through setDepth()
+	if (depthBucket && depth != depthBucketKey && !level->parallelPhase)
+		level->updateDepthBucket(*this);
+	updatingEntity = outer;
 }
 
-const std::string& Entity::getType() const
+const Entity::Type& Entity::getType() const
 {
 	return type;
 }
@@ -113,11 +166,22 @@ int Entity::getDepth() const
 void Entity::setDepth(int depth)
 {
 	this->depth = depth;
+	//	during a parallel update the Level catches up on depth changes once the bucket is done
+	if (depthBucket && depth != depthBucketKey && !level->parallelPhase)
+		level->updateDepthBucket(*this);
 }
 
 void Entity::destroy()
 {
-	dead = true;
+	//	only queued once, however many Entities destroy this
+	if (!dead.exchange(true))
+		level->queueDestroy(*this);
+}
+
+sf::Vector2f Entity::getInterpolatedPos() const
+{
+	const float t = level->getGame().getInterpolation();
+	return lastTickPos + (getPos() - lastTickPos) * t;
 }
 
 bool Entity::intersects(const sf::Rect<int>& bBox) const
@@ -138,31 +202,41 @@ sf::Rect<int> Entity::getBounds() const
 void Entity::setMask(DetailedMask::MaskRef maskDetails)
 {
 	collisionMask = CollisionMask(std::move(maskDetails));
-}
-
-std::shared_ptr<bool> Entity::aliveRef() const
-{
-	return ref;
+	//	the new mask hasn't been transformed yet
+	isTransformValid = false;
 }
 
 /*		protected		*/
-void Entity::addAutoCollisionCheck(const std::string& type)
+void Entity::addAutoCollisionCheck(const Type& type)
 {
-	for (const std::string& str : autoCollisionChecks)
-		if (str == type)
+	for (const Type& existing : autoCollisionChecks)
+		if (existing == type)
 			return;
 	autoCollisionChecks.push_back(type);
 }
 
 void Entity::updateMask()
 {
+	//	other Entities are read as they were before the parallel update started, never written
+	if (level->parallelPhase && updatingEntity != this)
+		return;
 	if (!isTransformValid)
 	{
 		collisionMask.updateTransform(transform().getTransform());
 		isTransformValid = true;
+		//	the broadphase is shared between threads, so the Level updates it after a parallel bucket instead
+		if (broadphase && !level->parallelPhase)
+			broadphase->update(*this);
 	}
 }
 
 /*		private			*/
+void Entity::queueMoved()
+{
+	//	an Entity moving itself is refiled by the updateMask() at the end of its update(), and others
+	//	are only read during the parallel phase. Not yet added means not in the broadphase yet either
+	if (broadphase && updatingEntity != this && !level->parallelPhase)
+		level->movedEntities.push_back(handle);
+}
 
 }
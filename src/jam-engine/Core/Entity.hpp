@@ -1,12 +1,16 @@
 #ifndef JE_ENTITY_HPP
 #define JE_ENTITY_HPP
 
+#include <atomic>
 #include <string>
 
 #include <SFML/Graphics.hpp>
 #include <SFML/Graphics/RenderStates.hpp>
 #include <SFML/Graphics/Transformable.hpp>
 
+#include "jam-engine/Core/EntityPool.hpp"
+#include "jam-engine/Core/EntityType.hpp"
+#include "jam-engine/Core/HandleTable.hpp"
 #include "jam-engine/Physics/CollisionMask.hpp"
 
 namespace je
@@ -14,16 +18,40 @@ namespace je
 
 class Level;
 
+class SpatialHash;
+
+class SpriteBatch;
+
 class Entity
 {
 public:
-	typedef std::string Type;
+	typedef EntityType Type;
 	virtual ~Entity();
 
+	//	every Entity carries an EntityPool header so pooled and heap allocated ones are deleted the same way
+	static void* operator new(std::size_t size);
+
+	static void operator delete(void *ptr);
+
 #ifdef JE_DEBUG
 	void debugDraw(sf::RenderTarget& target);
 #endif
 	virtual void draw(sf::RenderTarget& target, const sf::RenderStates &states = sf::RenderStates::Default) const = 0;
+
+	/**
+	 * Used instead of draw() when the Level has batched drawing on (see Level::setBatchedDrawing()).
+	 * Override it to add the Entity's sprites to the batch rather than drawing them.
+	 * @return false to be drawn with draw() instead, which is what happens by default
+	 */
+	virtual bool drawBatched(SpriteBatch& batch) const;
+
+	/**
+	 * What the Level culls the Entity against each camera's view with (see Level::setCameraCulling()).
+	 * Override it if the Entity draws outside of its mask.
+	 * @return The area draw() draws to, which is the mask's bounding box by default. If it's empty the Entity is never culled
+	 */
+	virtual sf::Rect<int> getDrawBounds() const;
+
 	void update();
 
 	const Type& getType() const;
@@ -34,7 +62,8 @@ public:
 
 	void setDepth(int depth);
 	/*
-	 * Marks the Entity to be destroyed at the end of the current update
+	 * Marks the Entity to be destroyed at the end of the current update.
+	 * Safe to call on other Entities from a parallel update.
 	 */
 	void destroy();
 
@@ -46,6 +75,10 @@ public:
 
 	sf::Rect<int> getBounds() const;
 
+	/**
+	 * For moving, rotating or scaling the Entity. Moving another Entity with this (outside of a
+	 * parallel update) queues it for the Level to refile in the broadphase before the next query.
+	 */
 	inline sf::Transformable& transform();
 
 	inline const sf::Transformable& transform() const;
@@ -55,11 +88,19 @@ public:
 
 	inline const sf::Vector2f& getPrevPos() const;
 
+	/**
+	 * For drawing with a fixed tick rate, see Game::setTickRate()
+	 * @return Where the Entity is between where its last update started and where it ended,
+	 * by Game::getInterpolation()
+	 */
+	sf::Vector2f getInterpolatedPos() const;
+
 	inline const CollisionMask& getMask() const;
 
 	void setMask(DetailedMask::MaskRef maskDetails);
 
-	std::shared_ptr<bool> aliveRef() const;
+	//!The Handle Refs to this Entity use to check whether it's still alive
+	inline const HandleTable::Handle& getHandle() const;
 
 protected:
 	Entity(Level * const level, const Type& type, const sf::Vector2f& startPos, const sf::Vector2i& dim, const sf::Vector2i offset = sf::Vector2i(0, 0));
@@ -75,16 +116,18 @@ protected:
 	//!The drawing depth for the Entity. Larger depths are drawn first, so lower ones appear on top of higher ones
 	int depth;
 
-	void addAutoCollisionCheck(const std::string& type);
+	void addAutoCollisionCheck(const Type& type);
 
 	void updateMask();
 
 
 
 private:
+	//!Has the Level refile this Entity in the broadphase before its next query, unless it's the one updating
+	void queueMoved();
 
-
-	bool dead;
+	//!Atomic since Entities updating in parallel may destroy the same other Entity
+	std::atomic<bool> dead;
 	const Type type;
 	////!These are the physical dimensions of the Entity
 	//sf::Vector2i dim;
@@ -93,13 +136,32 @@ private:
 #ifdef JE_DEBUG
 	sf::RectangleShape debugBounds;
 #endif
-	std::vector<std::string> autoCollisionChecks;
+	std::vector<Type> autoCollisionChecks;
 
 	CollisionMask collisionMask;
 	sf::Transformable transformable;
 	bool isTransformValid;
 
-	std::shared_ptr<bool> ref;
+	HandleTable::Handle handle;
+
+	//!Where the Entity was when its last update() started
+	sf::Vector2f lastTickPos;
+
+	//!The Level's broadphase this Entity is registered in, or nullptr if it hasn't been added yet
+	SpatialHash *broadphase;
+	//!The range of broadphase cells (not pixels) the mask currently covers
+	sf::Rect<int> broadphaseCells;
+	//!Where this Entity's bounds are in the broadphase's flat arrays
+	unsigned int broadphaseIndex;
+
+	//!The Level's draw list for depthBucketKey this Entity is in, or nullptr if it hasn't been added yet
+	std::vector<Entity*> *depthBucket;
+	//!The depth this Entity is filed under in the Level, which lags behind depth until the Level is told
+	int depthBucketKey;
+	unsigned int depthBucketIndex;
+
+	friend class Level;
+	friend class SpatialHash;
 };
 
 /*			inline implementation			*/
@@ -112,7 +174,11 @@ bool Entity::intersects(const Entity& other, float xoffset, float yoffset) const
 
 sf::Transformable& Entity::transform()
 {
-	isTransformValid = false;
+	if (isTransformValid)
+	{
+		isTransformValid = false;
+		this->queueMoved();
+	}
 	return transformable;
 }
 
@@ -136,6 +202,11 @@ const CollisionMask& Entity::getMask() const
 	return collisionMask;
 }
 
+const HandleTable::Handle& Entity::getHandle() const
+{
+	return handle;
+}
+
 } // or5
 
 #endif
@@ -0,0 +1,93 @@
+#include "jam-engine/Core/EntityPool.hpp"
+
+#include <atomic>
+#include <new>
+
+#include "jam-engine/Utility/Assert.hpp"
+
+namespace je
+{
+
+//	the header in front of each block, padded out to headerSize so the object stays aligned
+static inline EntityPool*& headerOf(void *object)
+{
+	return *reinterpret_cast<EntityPool**>(static_cast<char*>(object) - EntityPool::headerSize);
+}
+
+EntityPool::EntityPool(std::size_t objectSize, std::size_t blocksPerSlab)
+	:blockSize(headerSize + (objectSize + headerSize - 1) / headerSize * headerSize)
+	,blocksPerSlab(blocksPerSlab)
+	,slabs()
+	,freeList(nullptr)
+	,mutex()
+{
+	JE_ASSERT(blocksPerSlab > 0);
+}
+
+EntityPool::~EntityPool()
+{
+	for (char *slab : slabs)
+		::operator delete(slab);
+}
+
+void* EntityPool::allocate()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!freeList)
+		this->addSlab();
+	void *block = freeList;
+	freeList = *static_cast<void**>(block);
+	void *object = static_cast<char*>(block) + headerSize;
+	headerOf(object) = this;
+	return object;
+}
+
+void EntityPool::deallocate(void *object)
+{
+	JE_ASSERT(headerOf(object) == this);
+	std::lock_guard<std::mutex> lock(mutex);
+	void *block = static_cast<char*>(object) - headerSize;
+	*static_cast<void**>(block) = freeList;
+	freeList = block;
+}
+
+void* EntityPool::allocateUnpooled(std::size_t objectSize)
+{
+	void *object = static_cast<char*>(::operator new(headerSize + objectSize)) + headerSize;
+	headerOf(object) = nullptr;
+	return object;
+}
+
+void EntityPool::release(void *object)
+{
+	if (!object)
+		return;
+	EntityPool *pool = headerOf(object);
+	if (pool)
+		pool->deallocate(object);
+	else
+		::operator delete(static_cast<char*>(object) - headerSize);
+}
+
+/*		private			*/
+std::size_t EntityPool::nextTypeIndex()
+{
+	//	types can be seen for the first time from a parallel update
+	static std::atomic<std::size_t> count(0);
+	return count++;
+}
+
+void EntityPool::addSlab()
+{
+	char *slab = static_cast<char*>(::operator new(blockSize * blocksPerSlab));
+	slabs.push_back(slab);
+	//	link in reverse so blocks get handed out front to back
+	for (std::size_t i = blocksPerSlab; i-- > 0; )
+	{
+		void *block = slab + i * blockSize;
+		*static_cast<void**>(block) = freeList;
+		freeList = block;
+	}
+}
+
+} // je
@@ -0,0 +1,89 @@
+#ifndef JE_ENTITY_POOL_HPP
+#define JE_ENTITY_POOL_HPP
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace je
+{
+
+/**
+ * Slab allocator for Entities (or PolygonMasks) of a single C++ type. Memory is handed out from large slabs
+ * so same-type Entities sit next to each other, and blocks freed by destroyed Entities are
+ * reused (most recently freed first) before a new slab is ever allocated.
+ *
+ * Every Entity, pooled or not, is preceded by a small header recording which pool it came
+ * from, which is what lets a plain std::unique_ptr<Entity> free either kind correctly.
+ * Blocks are aligned to alignof(std::max_align_t), which is all an Entity type may ask for.
+ *
+ * Allocating and freeing are locked, since Entities can be created and destroyed from a parallel update.
+ * PolygonMask has a pool of its own, and keeps the transformed points of small polygons inline, so
+ * an Entity with a rectangle mask spawns and dies without touching the heap once the pools are warm.
+ */
+class EntityPool
+{
+public:
+	/**
+	 * @param objectSize sizeof() the type this pool allocates
+	 * @param blocksPerSlab How many objects to allocate room for at a time
+	 */
+	EntityPool(std::size_t objectSize, std::size_t blocksPerSlab = 128);
+
+	EntityPool(const EntityPool&) = delete;
+
+	EntityPool& operator=(const EntityPool&) = delete;
+
+	~EntityPool();
+
+	/**
+	 * @return Uninitialized memory for one object
+	 */
+	void* allocate();
+
+	/**
+	 * @param object Memory previously returned by allocate(), whose object has already been destroyed
+	 */
+	void deallocate(void *object);
+
+	/**
+	 * Allocates memory for an Entity with the same header as a pooled one, but from the global heap
+	 */
+	static void* allocateUnpooled(std::size_t objectSize);
+
+	/**
+	 * Frees memory from either allocate() or allocateUnpooled()
+	 */
+	static void release(void *object);
+
+	/**
+	 * @return A unique dense index for T, used by Level to find T's pool
+	 */
+	template <typename T>
+	static std::size_t typeIndex();
+
+	static const std::size_t headerSize = alignof(std::max_align_t);
+
+private:
+	static std::size_t nextTypeIndex();
+
+	void addSlab();
+
+	std::size_t blockSize;
+	std::size_t blocksPerSlab;
+	std::vector<char*> slabs;
+	//!Intrusive singly-linked list threaded through the free blocks
+	void *freeList;
+	std::mutex mutex;
+};
+
+template <typename T>
+std::size_t EntityPool::typeIndex()
+{
+	static const std::size_t index = nextTypeIndex();
+	return index;
+}
+
+} // je
+
+#endif // JE_ENTITY_POOL_HPP
@@ -0,0 +1,90 @@
+#include "jam-engine/Core/EntityType.hpp"
+
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+#include "jam-engine/Utility/Assert.hpp"
+
+namespace je
+{
+
+//	function-local so that static EntityTypes in other translation units can be safely initialized
+static std::unordered_map<std::string, EntityType::ID>& typeIDs()
+{
+	static std::unordered_map<std::string, EntityType::ID> ids;
+	return ids;
+}
+
+//	a deque so that references handed out by getName() stay valid as more types are registered
+static std::deque<std::string>& typeNames()
+{
+	static std::deque<std::string> names;
+	return names;
+}
+
+//	types can be interned by Entities constructed during a parallel update
+static std::mutex& registryMutex()
+{
+	static std::mutex mutex;
+	return mutex;
+}
+
+EntityType::EntityType(const std::string& name)
+	:id(intern(name))
+{
+}
+
+EntityType::EntityType(const char *name)
+	:id(intern(name))
+{
+}
+
+EntityType::ID EntityType::getID() const
+{
+	return id;
+}
+
+const std::string& EntityType::getName() const
+{
+	std::lock_guard<std::mutex> lock(registryMutex());
+	return typeNames()[id];
+}
+
+EntityType::operator const std::string&() const
+{
+	return getName();
+}
+
+EntityType::ID EntityType::count()
+{
+	std::lock_guard<std::mutex> lock(registryMutex());
+	return typeNames().size();
+}
+
+EntityType EntityType::fromID(ID id)
+{
+	JE_ASSERT(id < count());
+	return EntityType(id);
+}
+
+/*		private			*/
+EntityType::EntityType(ID id)
+	:id(id)
+{
+}
+
+EntityType::ID EntityType::intern(const std::string& name)
+{
+	std::lock_guard<std::mutex> lock(registryMutex());
+	auto& ids = typeIDs();
+	auto it = ids.find(name);
+	if (it != ids.end())
+		return it->second;
+	const ID id = typeNames().size();
+	typeNames().push_back(name);
+	ids.insert(std::make_pair(name, id));
+	return id;
+}
+
+} // je
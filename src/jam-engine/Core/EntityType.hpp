@@ -0,0 +1,67 @@
+#ifndef JE_ENTITY_TYPE_HPP
+#define JE_ENTITY_TYPE_HPP
+
+#include <string>
+
+namespace je
+{
+
+/**
+ * An interned Entity type name. The first time a name is seen it's registered and given a dense
+ * integer ID, after which comparing/looking up types is just an integer operation.
+ * Constructing from a string does a hash lookup, so hot code should keep the EntityType
+ * around (eg as a static const) rather than passing string literals every frame.
+ */
+class EntityType
+{
+public:
+	typedef unsigned int ID;
+
+	EntityType(const std::string& name);
+
+	EntityType(const char *name);
+
+	ID getID() const;
+
+	const std::string& getName() const;
+
+	//	compatibility with code that used to treat types as std::string
+	operator const std::string&() const;
+
+	/**
+	 * @return How many distinct types have been registered so far. All IDs are less than this.
+	 */
+	static ID count();
+
+	/**
+	 * @return The type registered with the given ID
+	 */
+	static EntityType fromID(ID id);
+
+	friend bool operator==(const EntityType& lhs, const EntityType& rhs)
+	{
+		return lhs.id == rhs.id;
+	}
+
+	friend bool operator!=(const EntityType& lhs, const EntityType& rhs)
+	{
+		return lhs.id != rhs.id;
+	}
+
+	//	orders by ID (ie registration order), not by name
+	friend bool operator<(const EntityType& lhs, const EntityType& rhs)
+	{
+		return lhs.id < rhs.id;
+	}
+
+private:
+	explicit EntityType(ID id);
+
+	static ID intern(const std::string& name);
+
+	ID id;
+};
+
+} // je
+
+#endif // JE_ENTITY_TYPE_HPP
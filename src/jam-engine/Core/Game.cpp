@@ -2,23 +2,45 @@
 
 #include "jam-engine/Core/Level.hpp"
 #include "jam-engine/Graphics/TexManager.hpp"
+#include "jam-engine/Utility/Assert.hpp"
+#include "jam-engine/Utility/Profiler.hpp"
+#include "jam-engine/Utility/ThreadPool.hpp"
 
 #include <iostream>
 #include <chrono>
+#include <cmath>
+#include <thread>
 
 #ifndef JE_FPS_APPROX_RATE
 	#define JE_FPS_APPROX_RATE 10
 #endif
 
+#ifndef JE_MAX_TICKS_PER_FRAME
+	#define JE_MAX_TICKS_PER_FRAME 5
+#endif
+
 namespace je
 {
 
-Game::Game(int width, int height, int framerate)
-	:window(sf::VideoMode(width, height), "")
+Game::Game(int width, int height, int framerate, Display display)
+	:window()
+	,display(display)
+	,offscreen()
+	,screenSize(width, height)
+	,running(false)
+	,nextFrame()
+	,lastTime()
+	,lastTimeExact()
+	,frameCounter(0)
+	,tickRate(0)
+	,maxTicksPerFrame(JE_MAX_TICKS_PER_FRAME)
+	,accumulator(0.0)
+	,lastTick()
+	,interpolation(1.f)
 	,view(sf::Vector2f(width / 2, height / 2), sf::Vector2f(width, height))
 	,level()
-	,input(window)
-	,texMan()
+	,input(window, display == Display::Window)
+	,texMan(this)
 	,maskManager()
 	,focused(true)
 	,currentFPS(0)
@@ -27,7 +49,15 @@ Game::Game(int width, int height, int framerate)
 	,debugDrawAABB(false)
 	,debugDrawDetails(true)
 #endif
+#ifdef JE_PROFILE
+	,profilerOverlay(false)
+	,profilerFont(nullptr)
+#endif
 {
+	if (display == Display::Window)
+		window.create(sf::VideoMode(width, height), "");
+	else if (display == Display::Offscreen)
+		offscreen.create(width, height);
 	this->setFPSCap(framerate);
 }
 
@@ -37,50 +67,48 @@ Game::~Game()
 
 int Game::execute()
 {
-	std::chrono::high_resolution_clock::time_point lastTime, lastTimeExact;
-	int counter = 0;
-	while (window.isOpen())
+	running = true;
+	nextFrame = lastTick = std::chrono::steady_clock::now();
+	accumulator = 0.0;
+	while (running && (display != Display::Window || window.isOpen()))
 	{
-		sf::Event event;
-		while (window.pollEvent(event))
-		{
-			if (event.type == sf::Event::Closed)
-				window.close();
-			else if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::Escape)
-				window.close();
-			else if (event.type == sf::Event::GainedFocus)
-				focused = true;
-			else if (event.type == sf::Event::LostFocus)
-				focused = false;
-		}
-
-		window.clear();
-
-		input.update();
-
-		if (level)
+		this->frame();
+		//	a window caps itself via setFramerateLimit(), otherwise it's up to us
+		if (display != Display::Window && FPSCap > 0)
 		{
-			level->update();
-
-			level->draw(window);
+			nextFrame += std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / FPSCap));
+			const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+			//	don't try to make up for frames that ran long, just carry on from now
+			if (nextFrame < now)
+				nextFrame = now;
+			else
+				std::this_thread::sleep_until(nextFrame);
 		}
-		oldlevels.clear();
+	}
+	running = false;
 
-		window.display();
+	return 0;
+}
 
-		std::chrono::high_resolution_clock::time_point currentTime = std::chrono::high_resolution_clock::now();
-		std::chrono::duration<double> frameTime = std::chrono::duration_cast<std::chrono::duration<double> >(currentTime - lastTimeExact);
-		exactFPS = frameTime.count() ? 1.0 / frameTime.count() : 123456789;
-		lastTimeExact = currentTime;
-		if (++counter % 10 == 0)
-		{
-			frameTime = std::chrono::duration_cast<std::chrono::duration<double> >(currentTime - lastTime);
-			currentFPS = frameTime.count() ? JE_FPS_APPROX_RATE / frameTime.count() : 123456789;
-			lastTime = currentTime;
-		}
+void Game::simulate(int frames)
+{
+	interpolation = 1.f;
+	for (int i = 0; i < frames; ++i)
+	{
+#ifdef JE_PROFILE
+		Profiler::beginFrame();
+#endif
+		this->tick();
+		this->render();
+#ifdef JE_PROFILE
+		Profiler::endFrame();
+#endif
 	}
+}
 
-	return 0;
+void Game::stop()
+{
+	running = false;
 }
 
 void Game::setLevel(std::unique_ptr<je::Level> level)
@@ -92,7 +120,8 @@ void Game::setLevel(std::unique_ptr<je::Level> level)
 void Game::setTitle(const std::string& title)
 {
 	this->title = title;
-	window.setTitle(title);
+	if (display == Display::Window)
+		window.setTitle(title);
 }
 
 const std::string& Game::getTitle() const
@@ -102,7 +131,8 @@ const std::string& Game::getTitle() const
 
 void Game::setFPSCap(int cap)
 {
-	window.setFramerateLimit(cap);
+	if (display == Display::Window)
+		window.setFramerateLimit(cap);
 	FPSCap = cap;
 }
 
@@ -121,6 +151,37 @@ double Game::getExactFPS() const
 	return exactFPS;
 }
 
+void Game::setTickRate(int rate)
+{
+	JE_ASSERT(rate >= 0);
+	tickRate = rate;
+	accumulator = 0.0;
+	lastTick = std::chrono::steady_clock::now();
+	interpolation = 1.f;
+}
+
+int Game::getTickRate() const
+{
+	return tickRate;
+}
+
+void Game::setMaxTicksPerFrame(int ticks)
+{
+	JE_ASSERT(ticks > 0);
+	maxTicksPerFrame = ticks;
+}
+
+float Game::getInterpolation() const
+{
+	return interpolation;
+}
+
+void Game::setVerticalSync(bool enabled)
+{
+	if (display == Display::Window)
+		window.setVerticalSyncEnabled(enabled);
+}
+
 Input& Game::getInput()
 {
 	return input;
@@ -146,6 +207,135 @@ sf::RenderWindow& Game::getWindow()
 	return window;
 }
 
+Game::Display Game::getDisplay() const
+{
+	return display;
+}
+
+sf::RenderTarget& Game::getRenderTarget()
+{
+	if (display == Display::Window)
+		return window;
+	return offscreen;
+}
+
+sf::Vector2u Game::getScreenSize() const
+{
+	if (display == Display::Window)
+		return window.getSize();
+	return screenSize;
+}
+
+ThreadPool& Game::getThreadPool()
+{
+	if (!threadPool)
+		threadPool.reset(new ThreadPool());
+	return *threadPool;
+}
+
+/*		private			*/
+void Game::frame()
+{
+#ifdef JE_PROFILE
+	Profiler::beginFrame();
+#endif
+	if (display == Display::Window)
+	{
+		sf::Event event;
+		while (window.pollEvent(event))
+		{
+			if (event.type == sf::Event::Closed)
+				window.close();
+			else if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::Escape)
+				window.close();
+			else if (event.type == sf::Event::GainedFocus)
+				focused = true;
+			else if (event.type == sf::Event::LostFocus)
+				focused = false;
+		}
+	}
+
+	//	before updating, so anything that finished loading can be used this frame
+	texMan.uploadPending();
+
+	if (tickRate > 0)
+	{
+		const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		accumulator += std::chrono::duration<double>(now - lastTick).count();
+		lastTick = now;
+		const double tickLength = 1.0 / tickRate;
+		int ticks = 0;
+		while (accumulator >= tickLength && ticks < maxTicksPerFrame)
+		{
+			this->tick();
+			accumulator -= tickLength;
+			++ticks;
+		}
+		//	whatever couldn't be caught up on is dropped, so the game slows down rather than falling further behind
+		if (accumulator >= tickLength)
+			accumulator = std::fmod(accumulator, tickLength);
+		interpolation = accumulator / tickLength;
+	}
+	else
+	{
+		this->tick();
+	}
+
+	this->render();
+
+	std::chrono::high_resolution_clock::time_point currentTime = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<double> frameTime = std::chrono::duration_cast<std::chrono::duration<double> >(currentTime - lastTimeExact);
+	exactFPS = frameTime.count() ? 1.0 / frameTime.count() : 123456789;
+	lastTimeExact = currentTime;
+	if (++frameCounter % 10 == 0)
+	{
+		frameTime = std::chrono::duration_cast<std::chrono::duration<double> >(currentTime - lastTime);
+		currentFPS = frameTime.count() ? JE_FPS_APPROX_RATE / frameTime.count() : 123456789;
+		lastTime = currentTime;
+	}
+#ifdef JE_PROFILE
+	Profiler::endFrame();
+#endif
+}
+
+void Game::tick()
+{
+	{
+		JE_PROFILE_ZONE("Input::update");
+		input.update();
+	}
+	if (level)
+	{
+		JE_PROFILE_ZONE("Level::update");
+		level->update();
+	}
+	oldlevels.clear();
+}
+
+void Game::render()
+{
+	if (display == Display::Headless)
+		return;
+	sf::RenderTarget& target = this->getRenderTarget();
+	target.clear();
+	if (level)
+	{
+		JE_PROFILE_ZONE("Level::draw");
+		level->draw(target);
+	}
+#ifdef JE_PROFILE
+	if (profilerOverlay)
+		Profiler::drawOverlay(target, profilerFont);
+#endif
+	{
+		JE_PROFILE_ZONE("display");
+		if (display == Display::Window)
+			window.display();
+		else
+			offscreen.display();
+	}
+}
+
 #ifdef JE_DEBUG
 void Game::setDebugCollisionDrawAABB(bool enabled)
 {
@@ -168,4 +358,12 @@ bool Game::getDebugCollisionDrawDetails() const
 }
 #endif
 
+#ifdef JE_PROFILE
+void Game::setProfilerOverlay(bool enabled, const sf::Font *font)
+{
+	profilerOverlay = enabled;
+	profilerFont = font;
+}
+#endif
+
 }
@@ -1,6 +1,7 @@
 #ifndef JE_GAME_HPP
 #define JE_GAME_HPP
 
+#include <chrono>
 #include <string>
 #include <vector>
 #include <memory>
@@ -14,14 +15,45 @@ namespace je
 
 class Level;
 
+class ThreadPool;
+
 class Game
 {
 public:
-	Game(int width, int height, int framerate);
+	//!Where a Game's frames go
+	enum class Display
+	{
+		//!A normal window that's drawn to and polls the real input devices
+		Window,
+		//!No window and no drawing, just Level updates. For simulations on machines with no display
+		Headless,
+		//!No window, but every frame is drawn to an sf::RenderTexture (see getRenderTarget())
+		Offscreen
+	};
+
+	/**
+	 * @param framerate The FPS cap, see setFPSCap()
+	 * @param display Whether to open a window. Without one the input devices are never polled,
+	 * and getInput() only sees what's given to Input::setState() (nothing held by default).
+	 */
+	Game(int width, int height, int framerate, Display display = Display::Window);
 	~Game();
 
+	/**
+	 * Runs frames until the window is closed or stop() is called
+	 */
 	int execute();
 
+	/**
+	 * Runs the given number of frames straight away, without any FPS cap, then returns.
+	 * Each frame is exactly one tick whatever the tick rate, so runs are repeatable.
+	 * Handy for driving a headless Game from a test or a replay.
+	 */
+	void simulate(int frames);
+
+	//!Makes execute() return after the current frame
+	void stop();
+
     void setLevel(std::unique_ptr<je::Level> level);
 
 	void setTitle(const std::string& title);
@@ -30,6 +62,9 @@ public:
 
 	bool isFocused() const;
 
+	/**
+	 * @param cap The most frames to run per second, or 0 for as many as possible
+	 */
 	void setFPSCap(int cap);
 
 	int getFPSCap() const;
@@ -38,6 +73,30 @@ public:
 
 	double getExactFPS() const;
 
+	/**
+	 * Decouples Level updates from drawing. Each frame runs however many ticks of 1/rate
+	 * seconds have built up since the last one, so the game runs at the same speed whatever
+	 * the framerate.
+	 * @param rate Ticks per second, or 0 to update exactly once per frame (the default)
+	 */
+	void setTickRate(int rate);
+
+	int getTickRate() const;
+
+	/**
+	 * Limits how many ticks a frame may run to catch up. When the updates can't keep up
+	 * the game slows down instead of spending longer and longer catching up each frame.
+	 */
+	void setMaxTicksPerFrame(int ticks);
+
+	/**
+	 * @return How far the time being drawn is between the last tick and the next one, from 0 to 1.
+	 * Always 1 when there's no tick rate. See Entity::getInterpolatedPos()
+	 */
+	float getInterpolation() const;
+
+	void setVerticalSync(bool enabled);
+
 	Input& getInput();
 
 	TexManager& getTexManager();
@@ -48,6 +107,23 @@ public:
 
 	sf::RenderWindow& getWindow();
 
+	Display getDisplay() const;
+
+	/**
+	 * @return The window, or the offscreen texture if there's no window. Not drawn to when Headless.
+	 */
+	sf::RenderTarget& getRenderTarget();
+
+	/**
+	 * @return The size of the window (or what it would have been without one)
+	 */
+	sf::Vector2u getScreenSize() const;
+
+	/**
+	 * @return The worker threads shared by the engine, started the first time this is called
+	 */
+	ThreadPool& getThreadPool();
+
 #ifdef JE_DEBUG
 	void setDebugCollisionDrawAABB(bool enabled);
 
@@ -58,8 +134,39 @@ public:
 	bool getDebugCollisionDrawDetails() const;
 #endif
 
+#ifdef JE_PROFILE
+	/**
+	 * Toggles drawing Profiler::drawOverlay() over the top of every frame
+	 * @param font Used to label the zones, if not null. Must outlive the overlay
+	 */
+	void setProfilerOverlay(bool enabled, const sf::Font *font = nullptr);
+#endif
+
 private:
+	//!Runs as many ticks as are due, then draws (unless Headless)
+	void frame();
+
+	//!Updates the input and Level once
+	void tick();
+
+	void render();
+
 	sf::RenderWindow window;
+	Display display;
+	sf::RenderTexture offscreen;
+	sf::Vector2u screenSize;
+	bool running;
+	//!When the next frame is due without a window to cap the framerate for us
+	std::chrono::steady_clock::time_point nextFrame;
+	std::chrono::high_resolution_clock::time_point lastTime;
+	std::chrono::high_resolution_clock::time_point lastTimeExact;
+	int frameCounter;
+	int tickRate;
+	int maxTicksPerFrame;
+	//!Seconds of simulation owed but not yet ticked
+	double accumulator;
+	std::chrono::steady_clock::time_point lastTick;
+	float interpolation;
 	sf::View view;
 	std::unique_ptr<Level> level;
 	std::string title;
@@ -71,10 +178,15 @@ private:
 	CollisionMaskManager maskManager;
 	bool focused;
 	std::vector<std::unique_ptr<Level>> oldlevels;
+	std::unique_ptr<ThreadPool> threadPool;
 #ifdef JE_DEBUG
 	bool debugDrawAABB;
 	bool debugDrawDetails;
 #endif
+#ifdef JE_PROFILE
+	bool profilerOverlay;
+	const sf::Font *profilerFont;
+#endif
 };
 
 }
@@ -0,0 +1,131 @@
+#include "jam-engine/Core/HandleTable.hpp"
+
+#include "jam-engine/Utility/Assert.hpp"
+
+namespace je
+{
+
+HandleTable::HandleTable()
+	:storage(acquireStorage())
+{
+}
+
+HandleTable::~HandleTable()
+{
+	recycleStorage(storage);
+}
+
+HandleTable::Handle HandleTable::allocate(Entity *entity)
+{
+	std::lock_guard<std::mutex> lock(storage->mutex);
+	std::vector<std::unique_ptr<Slot[]>>& pages = storage->pages;
+	uint32_t index;
+	if (!storage->freeSlots.empty())
+	{
+		index = storage->freeSlots.back();
+		storage->freeSlots.pop_back();
+	}
+	else
+	{
+		index = storage->slotCount++;
+		if ((index >> pageBits) >= pages.size())
+		{
+			JE_ASSERT_MSG(pages.size() < maxPages, "Too many live Entities for the HandleTable");
+			pages.emplace_back(new Slot[pageSize]);
+			for (uint32_t i = 0; i < pageSize; ++i)
+			{
+				pages.back()[i].entity = nullptr;
+				pages.back()[i].generation = 0;
+			}
+		}
+	}
+	Slot& slot = pages[index >> pageBits][index & (pageSize - 1)];
+	slot.entity = entity;
+	Handle handle;
+	handle.table = storage;
+	handle.index = index;
+	handle.generation = slot.generation;
+	return handle;
+}
+
+void HandleTable::release(const Handle& handle)
+{
+	JE_ASSERT(handle.table == storage);
+	std::lock_guard<std::mutex> lock(storage->mutex);
+	Slot& slot = storage->pages[handle.index >> pageBits][handle.index & (pageSize - 1)];
+	JE_ASSERT(slot.generation == handle.generation);
+	slot.entity = nullptr;
+	++slot.generation;
+	storage->freeSlots.push_back(handle.index);
+}
+
+void HandleTable::release(const std::vector<Handle>& handles)
+{
+	if (handles.empty())
+		return;
+	std::lock_guard<std::mutex> lock(storage->mutex);
+	storage->freeSlots.reserve(storage->freeSlots.size() + handles.size());
+	for (const Handle& handle : handles)
+	{
+		JE_ASSERT(handle.table == storage);
+		Slot& slot = storage->pages[handle.index >> pageBits][handle.index & (pageSize - 1)];
+		JE_ASSERT(slot.generation == handle.generation);
+		slot.entity = nullptr;
+		++slot.generation;
+		storage->freeSlots.push_back(handle.index);
+	}
+}
+
+/*		private		*/
+std::vector<HandleTable::Storage*>& HandleTable::spareStorage()
+{
+	//	never destroyed, so that Levels destroyed during static destruction can still recycle into it
+	static std::vector<Storage*> *spares = new std::vector<Storage*>();
+	return *spares;
+}
+
+std::mutex& HandleTable::spareStorageMutex()
+{
+	static std::mutex *mutex = new std::mutex();
+	return *mutex;
+}
+
+HandleTable::Storage* HandleTable::acquireStorage()
+{
+	{
+		std::lock_guard<std::mutex> lock(spareStorageMutex());
+		if (!spareStorage().empty())
+		{
+			Storage *storage = spareStorage().back();
+			spareStorage().pop_back();
+			return storage;
+		}
+	}
+	Storage *storage = new Storage();
+	storage->slotCount = 0;
+	//	reserved up front so that adding a page never moves the others
+	storage->pages.reserve(maxPages);
+	return storage;
+}
+
+void HandleTable::recycleStorage(Storage *storage)
+{
+	{
+		std::lock_guard<std::mutex> lock(storage->mutex);
+		//	generations only ever go up, so no Handle from before can match a slot again
+		for (std::unique_ptr<Slot[]>& page : storage->pages)
+		{
+			for (uint32_t i = 0; i < pageSize; ++i)
+			{
+				page[i].entity = nullptr;
+				++page[i].generation;
+			}
+		}
+		storage->freeSlots.clear();
+		storage->slotCount = 0;
+	}
+	std::lock_guard<std::mutex> lock(spareStorageMutex());
+	spareStorage().push_back(storage);
+}
+
+} // je
@@ -0,0 +1,110 @@
+#ifndef JE_HANDLE_TABLE_HPP
+#define JE_HANDLE_TABLE_HPP
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace je
+{
+
+class Entity;
+
+/**
+ * Maps (slot, generation) pairs to live Entities. Releasing a slot bumps its generation, which
+ * invalidates every Handle still pointing at it without having to track down the Handles.
+ * Slots live in fixed-size pages that are never moved, so growing the table never invalidates a lookup.
+ * Allocating and releasing are locked so Entities can be created from a parallel update, while lookups
+ * aren't since the only slots that can change underneath them belong to no live Handle.
+ *
+ * The slots outlive the table: when it's destroyed every generation is bumped and they're kept for
+ * the next table, so a Ref that outlives its Level just reads null rather than freed memory.
+ */
+class HandleTable
+{
+private:
+	struct Storage;
+
+public:
+	struct Handle
+	{
+		//!nullptr for a Handle that was never bound to anything
+		const Storage *table;
+		uint32_t index;
+		uint32_t generation;
+	};
+
+	HandleTable();
+
+	HandleTable(const HandleTable&) = delete;
+
+	HandleTable& operator=(const HandleTable&) = delete;
+
+	~HandleTable();
+
+	/**
+	 * @param entity The Entity the new Handle should refer to
+	 * @return A Handle to the Entity that stays valid until it's released
+	 */
+	Handle allocate(Entity *entity);
+
+	/**
+	 * Invalidates every copy of the given Handle and lets the slot be reused
+	 */
+	void release(const Handle& handle);
+
+	/**
+	 * Releases many Handles at once, taking the lock once rather than for each
+	 */
+	void release(const std::vector<Handle>& handles);
+
+	/**
+	 * @return The Entity referred to, or nullptr if the Handle has been released
+	 */
+	static inline Entity* get(const Handle& handle);
+
+private:
+	struct Slot
+	{
+		Entity *entity;
+		uint32_t generation;
+	};
+
+	static const uint32_t pageBits = 10;
+	static const uint32_t pageSize = 1 << pageBits;
+	static const uint32_t maxPages = 1024;
+
+	struct Storage
+	{
+		std::vector<std::unique_ptr<Slot[]>> pages;
+		std::vector<uint32_t> freeSlots;
+		uint32_t slotCount;
+		std::mutex mutex;
+	};
+
+	//!Reuses the slots of a destroyed table if there are any
+	static Storage* acquireStorage();
+
+	//!Invalidates every Handle into storage and keeps it for the next table
+	static void recycleStorage(Storage *storage);
+
+	//!The slots of destroyed tables, waiting for new ones
+	static std::vector<Storage*>& spareStorage();
+
+	static std::mutex& spareStorageMutex();
+
+	//!Never freed, see recycleStorage()
+	Storage *storage;
+};
+
+/*		inline implementation		*/
+Entity* HandleTable::get(const Handle& handle)
+{
+	const Slot& slot = handle.table->pages[handle.index >> pageBits][handle.index & (pageSize - 1)];
+	return slot.generation == handle.generation ? slot.entity : nullptr;
+}
+
+} // je
+
+#endif // JE_HANDLE_TABLE_HPP
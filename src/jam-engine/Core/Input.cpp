@@ -14,8 +14,26 @@ namespace je
 
 const float Input::joyAxisThreshhold = 0.2;
 
-Input::Input(sf::RenderWindow& window)
-	:window(window)
+Input::State::State()
+	:mousePos(0, 0)
+{
+	for (bool& b : keys)
+		b = false;
+	for (bool& b : buttons)
+		b = false;
+	for (int joystick = 0; joystick < sf::Joystick::Count; ++joystick)
+	{
+		for (bool& b : joyButtons[joystick])
+			b = false;
+		for (float& f : axes[joystick])
+			f = 0.f;
+	}
+}
+
+Input::Input(sf::RenderWindow& window, bool pollDevices)
+	:state()
+	,window(window)
+	,pollDevices(pollDevices)
 	,focused(true)
 {
 	for (int& i : keyUp)
@@ -45,9 +63,11 @@ Input::Input(sf::RenderWindow& window)
 
 void Input::update()
 {
+	if (pollDevices)
+		poll();
 	for (int key = 0; key < sf::Keyboard::KeyCount; ++key)
 	{
-		if (sf::Keyboard::isKeyPressed((sf::Keyboard::Key) key))
+		if (state.keys[key])
 		{
 			keyDown[key] = 2;
 			if (keyUp[key] > 0)
@@ -62,7 +82,7 @@ void Input::update()
 	}
 	for (int button = 0; button < sf::Mouse::ButtonCount; ++button)
 	{
-		if (sf::Mouse::isButtonPressed((sf::Mouse::Button) button))
+		if (state.buttons[button])
 		{
 			buttonDown[button] = 2;
 			if (buttonUp[button] > 0)
@@ -79,7 +99,7 @@ void Input::update()
 	{
 		for (int button = 0; button < sf::Joystick::ButtonCount; ++button)
 		{
-			if (sf::Joystick::isButtonPressed(joystick, button))
+			if (state.joyButtons[joystick][button])
 			{
 				joyDown[joystick][button] = 2;
 				if (joyUp[joystick][button] > 0)
@@ -127,6 +147,22 @@ void Input::setFocus(bool focus)
 	focused = focus;
 }
 
+void Input::setState(const State& state)
+{
+	if (!pollDevices)
+		this->state = state;
+}
+
+const Input::State& Input::getState() const
+{
+	return state;
+}
+
+bool Input::isPollingDevices() const
+{
+	return pollDevices;
+}
+
 /*			keyboard			*/
 bool Input::isKeyPressed(sf::Keyboard::Key key) const
 {
@@ -240,12 +276,7 @@ bool Input::isJoyAxisHeld(unsigned int joyID, sf::Joystick::Axis axis, bool nega
 
 float Input::axisPos(unsigned int joyID, sf::Joystick::Axis axis) const
 {
-	if (!sf::Joystick::hasAxis(joyID, axis))
-		return 0;
-	const int val = sf::Joystick::getAxisPosition(joyID, axis);
-	if (val > 101 || val < -101) // between -100 and 100 my ass, SFML!
-		return 0;
-	return val / 100.f;
+	return state.axes[joyID][axis];
 }
 
 bool Input::findController(unsigned int& joyID) const
@@ -302,4 +333,37 @@ bool Input::testAxis(unsigned int joyID, sf::Joystick::Axis& output, bool& negat
 	return false;
 }
 
+/*			mouse				*/
+sf::Vector2i Input::getMousePos() const
+{
+	return state.mousePos;
+}
+
+/*		private			*/
+void Input::poll()
+{
+	for (int key = 0; key < sf::Keyboard::KeyCount; ++key)
+		state.keys[key] = sf::Keyboard::isKeyPressed((sf::Keyboard::Key) key);
+	for (int button = 0; button < sf::Mouse::ButtonCount; ++button)
+		state.buttons[button] = sf::Mouse::isButtonPressed((sf::Mouse::Button) button);
+	for (int joystick = 0; joystick < sf::Joystick::Count; ++joystick)
+	{
+		for (int button = 0; button < sf::Joystick::ButtonCount; ++button)
+			state.joyButtons[joystick][button] = sf::Joystick::isButtonPressed(joystick, button);
+		for (int axis = 0; axis < AXES; ++axis)
+		{
+			float& pos = state.axes[joystick][axis];
+			pos = 0.f;
+			if (sf::Joystick::hasAxis(joystick, (sf::Joystick::Axis) axis))
+			{
+				const int val = sf::Joystick::getAxisPosition(joystick, (sf::Joystick::Axis) axis);
+				if (val <= 101 && val >= -101) // between -100 and 100 my ass, SFML!
+					pos = val / 100.f;
+			}
+		}
+	}
+	//	relative to the window, so that a recording means the same thing replayed without one
+	state.mousePos = sf::Mouse::getPosition(window);
+}
+
 }
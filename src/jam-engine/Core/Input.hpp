@@ -4,6 +4,7 @@
 #include <SFML/Window/Joystick.hpp>
 #include <SFML/Window/Keyboard.hpp>
 #include <SFML/Window/Mouse.hpp>
+#include <SFML/System/Vector2.hpp>
 
 #define AXES 8
 
@@ -14,16 +15,54 @@ class RenderWindow;
 namespace je
 {
 
+/**
+ * Keeps track of which keys and buttons went down or up between updates. Everything is read
+ * from a State, which update() fills in from the real devices if it polls them, or which is
+ * fed in with setState() if it doesn't, so a headless Game never touches the hardware and a
+ * replay can play back a recorded State per tick.
+ */
 class Input
 {
 public:
+	//!What's held down at one moment, whether polled from the devices or recorded
+	struct State
+	{
+		//!Nothing held, every axis centred and the mouse at (0, 0)
+		State();
+
+		bool keys[sf::Keyboard::KeyCount];
+		bool buttons[sf::Mouse::ButtonCount];
+		bool joyButtons[sf::Joystick::Count][sf::Joystick::ButtonCount];
+		//!From -1 to 1, and 0 for axes the joystick doesn't have
+		float axes[sf::Joystick::Count][AXES];
+		//!In pixels from the top left of the screen (the window's inside, or the screen of a Game without one)
+		sf::Vector2i mousePos;
+	};
+
 	static const float joyAxisThreshhold;
 
-	Input(sf::RenderWindow& window);
+	/**
+	 * @param pollDevices Whether update() reads the real keyboard, mouse and joysticks.
+	 * If not, it uses whatever State was last given to setState(), which is nothing held until then.
+	 */
+	Input(sf::RenderWindow& window, bool pollDevices = true);
 
+	//!Polls the devices (if it does) then works out what went down or up since the last update
 	void update();
 	void setFocus(bool focus);
 
+	/**
+	 * Sets what's held for the next update() onwards. Ignored while the devices are polled.
+	 * Recording getState() after every update of a windowed Game and feeding it back here
+	 * each tick of a headless one replays the same input.
+	 */
+	void setState(const State& state);
+
+	//!What was held as of the last update()
+	const State& getState() const;
+
+	bool isPollingDevices() const;
+
 	/*			keyboard		*/
 	bool isKeyPressed(sf::Keyboard::Key key) const;
 	bool isKeyReleased(sf::Keyboard::Key key) const;
@@ -55,6 +94,7 @@ public:
 	bool isJoyAxisReleased(unsigned int joyID, sf::Joystick::Axis axis, bool negative = false) const;
 	bool isJoyAxisHeld(unsigned int joyID, sf::Joystick::Axis axis, bool negative = false) const;
 
+	//!From -1 to 1, as of the last update()
 	float axisPos(unsigned int joyID, sf::Joystick::Axis axis) const;
 
 	/**
@@ -73,7 +113,15 @@ public:
 	 */
 	bool testAxis(unsigned int joyID, sf::Joystick::Axis& output, bool& negative) const;
 
+	/*			mouse			*/
+	//!In pixels from the top left of the screen, as of the last update()
+	sf::Vector2i getMousePos() const;
+
 private:
+	//!Reads the real devices into state
+	void poll();
+
+	State state;
 	int buttonUp[sf::Mouse::ButtonCount];
 	int buttonDown[sf::Mouse::ButtonCount];
 	int keyUp[sf::Keyboard::KeyCount];
@@ -85,6 +133,7 @@ private:
 	int negAxisUp[sf::Joystick::Count][AXES];
 	int negAxisDown[sf::Joystick::Count][AXES];
 	sf::RenderWindow& window;
+	bool pollDevices;
 	bool focused;
 };
 
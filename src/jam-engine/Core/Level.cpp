@@ -1,5 +1,6 @@
 #include "jam-engine/Core/Level.hpp"
 
+#include <cmath>
 #include <cstdlib>
 #include <iostream>
 #include <sstream>
@@ -10,22 +11,62 @@
 #include "jam-engine/Core/Camera.hpp"
 #include "jam-engine/Core/Game.hpp"
 #include "jam-engine/Graphics/TexManager.hpp"
+#include "jam-engine/Physics/CircleMask.hpp"
 #include "jam-engine/Utility/Assert.hpp"
 #include "jam-engine/Utility/Math.hpp"
+#include "jam-engine/Utility/Profiler.hpp"
+#include "jam-engine/Utility/ThreadPool.hpp"
 #include "jam-engine/Utility/Trig.hpp"
 
 #ifdef JE_XML_LEVELS
 	#include "rapidxml.hpp"
 #endif // JE_XML_LEVELS
 
+#ifndef JE_BROADPHASE_CELL_SIZE
+	#define JE_BROADPHASE_CELL_SIZE 64
+#endif
+
+//	parallel-safe buckets smaller than this aren't worth waking the thread pool for
+#ifndef JE_PARALLEL_MIN_BUCKET
+	#define JE_PARALLEL_MIN_BUCKET 64
+#endif
+
 namespace je
 {
 
+//	scratch space for broadphase results, per thread since queries can come from a parallel update.
+//	Queries only ever append past where they started so nested queries are safe
+static thread_local std::vector<Entity*> queryCandidates;
+
+//!The area a view shows, rounded outwards so that culling never drops something partly on screen
+static sf::Rect<int> getViewBounds(const sf::View& view)
+{
+	const sf::Vector2f topLeft = view.getCenter() - view.getSize() / 2.f;
+	const sf::Vector2f bottomRight = view.getCenter() + view.getSize() / 2.f;
+	const sf::Vector2i min(std::floor(topLeft.x), std::floor(topLeft.y));
+	return sf::Rect<int>(min, sf::Vector2i(std::ceil(bottomRight.x) - min.x, std::ceil(bottomRight.y) - min.y));
+}
+
+//!Empty bounds (such as an Entity with a 0x0 mask) never intersect anything, so they're never culled
+static bool isCulled(const sf::Rect<int>& drawBounds, const sf::Rect<int>& viewBounds)
+{
+	return drawBounds.width != 0 && drawBounds.height != 0 && !drawBounds.intersects(viewBounds);
+}
+
 Level::Level(Game * const game, int width, int height)
 	:width(width)
 	,height(height)
 	,game(game)
 	,states (sf::RenderStates::Default)
+	,updateOrderDirty(false)
+	,parallelUpdate(false)
+	,parallelPhase(false)
+	,parallelBucket(0)
+	,updating(false)
+	,batchedDrawing(false)
+	,cameraCulling(false)
+	,batch()
+	,drawStats()
 {
 	this->init();
 }
@@ -35,6 +76,15 @@ Level::Level(Game * const game)
 	,height(0)
 	,game(game)
 	,states (sf::RenderStates::Default)
+	,updateOrderDirty(false)
+	,parallelUpdate(false)
+	,parallelPhase(false)
+	,parallelBucket(0)
+	,updating(false)
+	,batchedDrawing(false)
+	,cameraCulling(false)
+	,batch()
+	,drawStats()
 {
 	this->init();
 }
@@ -46,12 +96,17 @@ Level::~Level()
 
 void Level::draw(sf::RenderTarget& target) const
 {
+	//	not assigned a new DrawStats, to keep the memory for the per-camera stats
+	drawStats.drawCalls = 0;
+	drawStats.batchedEntities = 0;
+	drawStats.unbatchedEntities = 0;
+	drawStats.cameras.clear();
 	if (cameras.empty())
 	{
 		sf::View view = target.getDefaultView();
 		//view.zoom(2.f);
 		target.setView(view);
-		this->drawEntities(target, sf::Rect<int>(0, 0, width, height));
+		this->drawEntities(target, getViewBounds(view));
 	}
 	else
 	{
@@ -59,8 +114,7 @@ void Level::draw(sf::RenderTarget& target) const
 		{
 			const sf::View& v = cam->getView();
 			target.setView(v);
-			sf::Rect<int> cameraBounds(sf::Vector2i(v.getCenter() - v.getSize() / 2.f), sf::Vector2i(v.getSize()));
-			this->drawEntities(target, cameraBounds);
+			this->drawEntities(target, getViewBounds(v));
 		}
 	}
 	target.setView(target.getDefaultView());
@@ -80,79 +134,47 @@ void Level::update()
 #ifdef JE_DEBUG
 	debugDrawRects.clear();
 #endif
-	for (const std::string& type : specificOrderEntitiesPre)
-	{
-		auto& entityList = entities[type];
-		for (unsigned int i = 0; i < entityList.size(); )
-		{
-			entityList[i]->update();
-			if (entityList[i]->isDead())
-			{
-				entityList[i] = std::move(entityList.back());
-				entityList.pop_back();
-			}
-			else
-				++i;
-		}
-	}
-	for (auto& p : entities)
+	if (updateOrderDirty)
 	{
-		auto it = hasSpecificUpdateOrder.find(p.first);
-		if (it != hasSpecificUpdateOrder.end() && it->second == true)
-			continue;
-		for (unsigned int i = 0; i < p.second.size(); )
-		{
-			p.second[i]->update();
-			if (p.second[i]->isDead())
-			{
-				p.second[i] = std::move(p.second.back());
-				p.second.pop_back();
-			}
-			else
-				++i;
-		}
+		std::sort(updateOrder.begin(), updateOrder.end(), [](Entity::Type::ID a, Entity::Type::ID b) -> bool {
+			return Entity::Type::fromID(a).getName() < Entity::Type::fromID(b).getName();
+		});
+		updateOrderDirty = false;
 	}
-	for (const std::string& type : specificOrderEntitiesPost)
+	updating = true;
+	for (const Entity::Type& type : specificOrderEntitiesPre)
+		this->updateBucket(type.getID());
+	//	indexed since types first seen during this update are appended to updateOrder
+	for (std::size_t i = 0; i < updateOrder.size(); ++i)
 	{
-		auto& entityList = entities[type];
-		for (unsigned int i = 0; i < entityList.size(); )
-		{
-			entityList[i]->update();
-			if (entityList[i]->isDead())
-			{
-				entityList[i] = std::move(entityList.back());
-				entityList.pop_back();
-			}
-			else
-				++i;
-		}
+		const Entity::Type::ID id = updateOrder[i];
+		if (!hasSpecificUpdateOrder[id])
+			this->updateBucket(id);
 	}
+	for (const Entity::Type& type : specificOrderEntitiesPost)
+		this->updateBucket(type.getID());
 	onUpdate();
-	//	depth sort
-	depthBuffer.clear();
-	for (auto& p : entities)
-		for (std::unique_ptr<Entity>& entity : p.second)
-			depthBuffer.push_back(entity.get());
-	std::sort(depthBuffer.begin(), depthBuffer.end(), [](const Entity *a, const Entity *b) -> bool {
-		return a->getDepth() == b->getDepth() ? (int)(size_t) a > (int)(size_t) b : a->getDepth() > b->getDepth();
-	});
+	updating = false;
+	this->applyCommands();
+	this->compactDepthBuckets();
+	//	so that the queue doesn't grow in a Level that never queries
+	this->flushMovedEntities();
 }
 
 Ref<Entity> Level::testCollision(const sf::Rect<int>& bBox, Entity::Type type)
 {
+	JE_PROFILE_ZONE("Level::testCollision");
 	Entity *retVal = nullptr;
-	auto mit = entities.find(type);
-	if (mit != entities.end())
+	const std::size_t first = gatherCandidates(bBox, type);
+	for (std::size_t i = first; i < queryCandidates.size(); ++i)
 	{
-		for (std::unique_ptr<Entity>& entity : mit->second)
+		if (queryCandidates[i]->intersects(bBox))
 		{
-			if (entity->getType() == type && entity->intersects(bBox))
-			{
-				retVal = entity.get();
-				break;
-			}
+			retVal = queryCandidates[i];
+			break;
 		}
 	}
+	queryCandidates.resize(first);
 	this->debugDrawRect(bBox, !retVal ? sf::Color::Yellow : sf::Color::Green);
 	return retVal ? Ref<Entity>(*retVal) : Ref<Entity>();
 }
@@ -161,64 +183,71 @@ Ref<Entity> Level::testCollision(const sf::Rect<int>& bBox, Entity::Type type)
 
 Ref<Entity> Level::testCollision(Entity *caller, Entity::Type type, float xoffset, float yoffset)
 {
+	JE_PROFILE_ZONE("Level::testCollision");
 	caller->transform().move(xoffset, yoffset);
+	caller->updateMask();
 	Entity *retVal = nullptr;
-	auto mit = entities.find(type);
-	if (mit != entities.end())
+	const std::size_t first = gatherCandidates(caller->getMask().getAABB(), type);
+	for (std::size_t i = first; i < queryCandidates.size(); ++i)
 	{
-		for (std::unique_ptr<Entity>& entity : mit->second)
+		Entity *entity = queryCandidates[i];
+		if (entity != caller && caller->intersects(*entity, xoffset, yoffset))
 		{
-			if (entity.get() != caller && entity->getType() == type && caller->intersects(*entity, xoffset, yoffset))
-			{
-				retVal = entity.get();
-				break;
-			}
+			retVal = entity;
+			break;
 		}
 	}
+	queryCandidates.resize(first);
 	//sf::Rect<int> rect = caller->getBounds();
 	//rect.left += xoffset;
 	//rect.top += yoffset;
 	//this->debugDrawRect(rect, !retVal ? sf::Color::Yellow : sf::Color::Green);
 	caller->transform().move(-xoffset, -yoffset);
+	//	otherwise it stays filed at the offset position until its next update
+	caller->updateMask();
 	return retVal ? Ref<Entity>(*retVal) : Ref<Entity>();
 }
 
 Ref<Entity> Level::testCollision(Entity *caller, Entity::Type type, std::function<bool(const Entity&)> filter, float xoffset, float yoffset)
 {
+	JE_PROFILE_ZONE("Level::testCollision");
 	caller->transform().move(xoffset, yoffset);
+	caller->updateMask();
 	Entity *retVal = nullptr;
-	auto mit = entities.find(type);
-	if (mit != entities.end())
+	const std::size_t first = gatherCandidates(caller->getMask().getAABB(), type);
+	for (std::size_t i = first; i < queryCandidates.size(); ++i)
 	{
-		for (std::unique_ptr<Entity>& entity : mit->second)
+		Entity *entity = queryCandidates[i];
+		if (entity != caller && filter(*entity) && caller->intersects(*entity, xoffset, yoffset))
 		{
-			if (entity.get() != caller && entity->getType() == type && filter(*entity) && caller->intersects(*entity, xoffset, yoffset))
-			{
-				retVal = entity.get();
-				break;
-			}
+			retVal = entity;
+			break;
 		}
 	}
+	queryCandidates.resize(first);
 	//sf::Rect<int> rect = caller->getBounds();
 	//rect.left += xoffset;
 	//rect.top += yoffset;
 	//this->debugDrawRect(rect, !retVal ? sf::Color::Yellow : sf::Color::Green);
 	caller->transform().move(-xoffset, -yoffset);
+	//	otherwise it stays filed at the offset position until its next update
+	caller->updateMask();
 	return retVal ? Ref<Entity>(*retVal) : Ref<Entity>();
 }
 
 void Level::findCollisions(std::vector<Ref<Entity>>& results, const Entity *caller, Entity::Type type, float xoffset, float yoffset)
 {
-	//	TODO: ADD CULLING
-	auto mit = entities.find(type);
-	if (mit != entities.end())
+	JE_PROFILE_ZONE("Level::findCollisions");
+	//	the offset isn't applied to the caller here, so neither is it applied to the query
+	((Entity*)caller)->updateMask();
+	const std::size_t first = gatherCandidates(caller->getMask().getAABB(), type);
+	for (std::size_t i = first; i < queryCandidates.size(); ++i)
 	{
-		for (std::unique_ptr<Entity>& entity : mit->second)
-		{
-			if (entity.get() != caller && entity->getType() == type && caller->intersects(*entity, xoffset, yoffset))
-				results.push_back(Ref<Entity>(*entity));
-		}
+		Entity *entity = queryCandidates[i];
+		if (entity != caller && caller->intersects(*entity, xoffset, yoffset))
+			results.push_back(Ref<Entity>(*entity));
 	}
+	queryCandidates.resize(first);
 	//sf::Rect<int> rect = caller->getBounds();
 	//rect.left += xoffset;
 	//rect.top += yoffset;
@@ -227,22 +256,28 @@ void Level::findCollisions(std::vector<Ref<Entity>>& results, const Entity *call
 
 void Level::findCollisions(std::vector<Ref<Entity>>& results, const sf::Rect<int>& bBox, Entity::Type type)
 {
-	// TOOD: don't hack aroundlike this
-	findCollisions(results, bBox, type, [](Entity&) -> bool { return true; });
+	JE_PROFILE_ZONE("Level::findCollisions");
+	const std::size_t first = gatherCandidates(bBox, type);
+	for (std::size_t i = first; i < queryCandidates.size(); ++i)
+	{
+		if (queryCandidates[i]->intersects(bBox))
+			results.push_back(Ref<Entity>(*queryCandidates[i]));
+	}
+	queryCandidates.resize(first);
+	this->debugDrawRect(bBox, results.empty() ? sf::Color::Yellow : sf::Color::Green);
 }
 
 void Level::findCollisions(std::vector<Ref<Entity>>& results, const sf::Rect<int>& bBox, Entity::Type type, std::function<bool(Entity&)> filter)
 {
-	//	TODO: ADD CULLING
-	auto mit = entities.find(type);
-	if (mit != entities.end())
+	JE_PROFILE_ZONE("Level::findCollisions");
+	const std::size_t first = gatherCandidates(bBox, type);
+	for (std::size_t i = first; i < queryCandidates.size(); ++i)
 	{
-		for (std::unique_ptr<Entity>& entity : mit->second)
-		{
-			if (entity->getType() == type && entity->intersects(bBox) && filter(*entity))
-				results.push_back(Ref<Entity>(*entity));
-		}
+		Entity *entity = queryCandidates[i];
+		if (entity->intersects(bBox) && filter(*entity))
+			results.push_back(Ref<Entity>(*entity));
 	}
+	queryCandidates.resize(first);
 	this->debugDrawRect(bBox, results.empty() ? sf::Color::Yellow : sf::Color::Green);
 }
 
@@ -256,56 +291,44 @@ void findCollisions(std::vector<Ref<Entity>>& results, const sf::Rect<int>& bBox
 	JE_ERROR("Not implemented");
 }
 
-sf::Vector2f rayCast(const Entity *caller, Entity::Type type, const sf::Vector2f& veloc, std::function<bool(Entity&)> filter)
+sf::Vector2f Level::rayCast(const Entity *caller, Entity::Type type, const sf::Vector2f& veloc)
 {
-	//	TODO: implement legit
-	std::vector<Ref<Entity>> possibleMatches;
-	//	find out the minimal bounding box that covers the entire possible area this cast would query
-	sf::Rect<int> maxBounds = caller->getBounds();
-	if (veloc.x > 0)
-		maxBounds.width += veloc.x;
-	else
-	{
-		maxBounds.width -= veloc.x;
-		maxBounds.left += veloc.x;
-	}
-	if (veloc.y > 0)
-		maxBounds.height += veloc.y;
-	else
-	{
-		maxBounds.height -= veloc.y;
-		maxBounds.top += veloc.y;
-	}
-	findCollisions(possibleMatches, maxBounds, type, filter);
-	sf::Vector2f offset = caller->transform().getPosition();
-	sf::Rect<int> queryBox = caller->getBounds();
-	//	find out the largest distance you could travel without skipping through things when moving
-	float jumpDist = min(abs(caller->getDimensions().x), abs(caller->getDimensions().y));
-	int totalDist = length(veloc);
-	int reps = totalDist / jumpDist + 1;
-	//	create a vector that represents how far the entity will move each jump
-	sf::Vector2f jumpVec(lengthdir((float) totalDist / reps, direction(veloc)));
-	for (int i = 0; i < reps; ++i)
-	{
-		offset += jumpVec;
-		queryBox.left = offset.x;
-		queryBox.top = offset.y;
-		for (const Ref<Entity>& e : possibleMatches)
-		{
-			//	we hit something - now do a cast with smaller jump distances
-			if (e->intersects(queryBox))
-			{
-				float scaleDown = max(abs(jumpVec.x), abs(jumpVec.y));
-				// 	todo: implement
-				return offset;
-			}
-		}
-	}
-	return offset;
+	return this->rayCast(caller, type, veloc, nullptr);
+}
+
+sf::Vector2f Level::rayCast(const Entity *caller, Entity::Type type, const sf::Vector2f& veloc, std::function<bool(Entity&)> filter)
+{
+	RayCastResult result;
+	if (this->rayCast(result, caller, type, veloc, filter))
+		return result.position;
+	return caller->getPos() + veloc;
+}
+
+bool Level::rayCast(RayCastResult& result, const Entity *caller, Entity::Type type, const sf::Vector2f& veloc, std::function<bool(Entity&)> filter)
+{
+	JE_PROFILE_ZONE("Level::rayCast");
+	((Entity*)caller)->updateMask();
+	if (!this->sweepMask(result, caller->getMask(), caller, type, veloc, filter))
+		return false;
+	result.position = caller->getPos() + veloc * result.time;
+	return true;
+}
+
+bool Level::rayCast(RayCastResult& result, const sf::Vector2f& start, Entity::Type type, const sf::Vector2f& veloc, std::function<bool(Entity&)> filter)
+{
+	JE_PROFILE_ZONE("Level::rayCast");
+	//	a ray is just a circle with no radius
+	CollisionMask point(DetailedMask::MaskRef(new CircleMask(0.f)));
+	point.updateTransform(sf::Transform().translate(start));
+	if (!this->sweepMask(result, point, nullptr, type, veloc, filter))
+		return false;
+	result.position = start + veloc * result.time;
+	return true;
 }
 
 sf::Vector2f Level::rayCastManually(bool& hit, const Entity *caller, std::initializer_list<Entity::Type> types, std::function<bool(Entity&)> filter, const sf::Vector2f& veloc, float stepSize)
 {
+	JE_PROFILE_ZONE("Level::rayCastManually");
 	sf::Vector2f pos = caller->getPos();
 	//	TODO: implement legit
 	std::vector<Ref<Entity>> possibleMatches;
@@ -351,38 +374,61 @@ sf::Vector2f Level::rayCastManually(bool& hit, const Entity *caller, std::initia
 
 Ref<Entity> Level::addEntity(std::unique_ptr<Entity> instance)
 {
-	auto& vec = entities[instance->getType()];
+	if (updating)
+	{
+		Ref<Entity> ref(*instance);
+		if (parallelPhase)
+		{
+			std::lock_guard<std::mutex> lock(commandMutex);
+			spawnQueue.push_back(std::move(instance));
+		}
+		else
+			spawnQueue.push_back(std::move(instance));
+		return ref;
+	}
+	const Entity::Type::ID id = instance->getType().getID();
+	this->registerType(instance->getType());
+	instance->updateMask();
+	broadphase[id]->insert(*instance);
+	this->insertIntoDepthBuckets(*instance);
+	auto& vec = entities[id];
 	vec.push_back(std::move(instance));
 	return Ref<Entity>(*vec.back());
 }
 
 void Level::addEntity(Entity *instance)
 {
-	entities[instance->getType()].push_back(std::unique_ptr<Entity>(instance));
+	this->addEntity(std::unique_ptr<Entity>(instance));
 }
 
 
 
 void Level::clear()
 {
-	entities.clear();
+	spawnQueue.clear();
+	destroyQueue.clear();
+	//	Entities unregister themselves from the broadphase as they're destroyed
+	for (auto& bucket : entities)
+		bucket.clear();
 	tileLayers.clear();
 	tileSprites.clear();
 }
 
 void Level::clearEntities()
 {
-	for (auto& p : entities)
+	const Entity::Type tileGridType("TileGrid");
+	for (std::size_t id = 0; id < entities.size(); ++id)
 	{
-		if (p.first == "TileGrid")
+		auto& bucket = entities[id];
+		if (id == tileGridType.getID())
 		{
 			bool isTile = false;
-			for (unsigned int i = 0; i < p.second.size(); ++i)
+			for (unsigned int i = 0; i < bucket.size(); ++i)
 			{
 				isTile = false;
 				for (auto& it : tileLayers)
 				{
-					if (p.second[i].get() == it.second)
+					if (bucket[i].get() == it.second)
 					{
 						isTile = true;
 						break;
@@ -390,17 +436,18 @@ void Level::clearEntities()
 				}
 				if (!isTile)
 				{
-					p.second[i] = std::move(p.second.back());
-					p.second.pop_back();
+					bucket[i] = std::move(bucket.back());
+					bucket.pop_back();
 					--i;
 				}
 			}
 		}
 		else
 		{
-			p.second.clear();
+			bucket.clear();
 		}
 	}
+	spawnQueue.clear();
 }
 
 int Level::getWidth() const
@@ -450,10 +497,9 @@ Game& Level::getGame() const
 sf::Vector2f Level::getCursorPos() const
 {
 	sf::FloatRect viewBox(0, 0, width, height);
-	sf::Vector2i windowMousePos = game->getWindow().mapCoordsToPixel(sf::Vector2f(sf::Mouse::getPosition().x, sf::Mouse::getPosition().y)) - game->getWindow().getPosition();
-	// HACK: add the window top bit to the y position because SFML doesn't seem to do it...
-	windowMousePos.x -= 8;
-	windowMousePos.y -= 30;
+	//	already relative to the inside of the window (or the screen, without one), so there's no
+	//	window position or title bar to take off, and a headless replay gets the same answer
+	const sf::Vector2i windowMousePos = game->getInput().getMousePos();
 
 	for (const Camera *cam : cameras)
 	{
@@ -695,6 +741,9 @@ void Level::loadXMLMap(const std::string& filename)
 void Level::debugDrawRect(const sf::Rect<int>& rect, sf::Color outlineColor, sf::Color fillColor, int outlineThickness)
 {
 #ifdef JE_DEBUG
+	//	not worth a lock for debug drawing
+	if (parallelPhase)
+		return;
 	debugDrawRects.push_back(sf::RectangleShape(sf::Vector2f(rect.width, rect.height)));
 	sf::RectangleShape& r = debugDrawRects.back();
 	r.setPosition(rect.left, rect.top);
@@ -704,22 +753,63 @@ void Level::debugDrawRect(const sf::Rect<int>& rect, sf::Color outlineColor, sf:
 #endif
 }
 
-void Level::setSpecificOrderEntitiesPre(std::initializer_list<std::string> order)
+void Level::setSpecificOrderEntitiesPre(std::initializer_list<Entity::Type> order)
 {
 	specificOrderEntitiesPre.clear();
-	for (const std::string& type : order)
+	for (const Entity::Type& type : order)
+	{
+		this->registerType(type);
 		specificOrderEntitiesPre.push_back(type);
+	}
 	this->fixUpdateOrder();
 }
 
-void Level::setSpecificOrderEntitiesPost(std::initializer_list<std::string> order)
+void Level::setSpecificOrderEntitiesPost(std::initializer_list<Entity::Type> order)
 {
 	specificOrderEntitiesPost.clear();
-	for (const std::string& type : order)
+	for (const Entity::Type& type : order)
+	{
+		this->registerType(type);
 		specificOrderEntitiesPost.push_back(type);
+	}
 	this->fixUpdateOrder();
 }
 
+void Level::setParallelUpdate(bool enabled)
+{
+	parallelUpdate = enabled;
+}
+
+void Level::setParallelSafe(std::initializer_list<Entity::Type> types)
+{
+	parallelSafe.assign(parallelSafe.size(), false);
+	for (const Entity::Type& type : types)
+	{
+		this->registerType(type);
+		parallelSafe[type.getID()] = true;
+	}
+}
+
+bool Level::isUpdatingInParallel() const
+{
+	return parallelPhase;
+}
+
+void Level::setBatchedDrawing(bool enabled)
+{
+	batchedDrawing = enabled;
+}
+
+void Level::setCameraCulling(bool enabled)
+{
+	cameraCulling = enabled;
+}
+
+const Level::DrawStats& Level::getDrawStats() const
+{
+	return drawStats;
+}
+
 void Level::registerCamera(const Camera *camera)
 {
 	for (const Camera *cam : cameras)
@@ -743,6 +833,12 @@ void Level::unregisterCamera(const Camera *camera)
 
 /*		protected			*/
 
+const std::vector<std::unique_ptr<Entity>>& Level::getEntities(const Entity::Type& type) const
+{
+	static const std::vector<std::unique_ptr<Entity>> none;
+	return type.getID() < entities.size() ? entities[type.getID()] : none;
+}
+
 void Level::onUpdate()
 {
 	//	purposefully empty - meant for subclass-specific behaviour
@@ -789,17 +885,18 @@ void Level::loadEntities(const std::string& layerName, const std::vector<EntityP
 void Level::createTiles(const std::string& filename, int tileWidth, int tileHeight, int tilesAcross, int tilesHigh)
 {
 	std::cout << "tileWidth : " << tileWidth << "\nTileHeight" << tileHeight << "\n";
-	const sf::Texture& texture = getGame().getTexManager().get(filename);
-	const int w = texture.getSize().x / tileWidth;
-	const int h = texture.getSize().y / tileHeight;
+	//	tile sets small enough to be packed share a texture with other images, so they can be batched with them
+	const TextureRegion& region = getGame().getTexManager().getRegion(filename);
+	const int w = region.rect.width / tileWidth;
+	const int h = region.rect.height / tileHeight;
 	std::cout << "should create " << w * h << " sprites created\n";
 	for (int y = 0; y < h; ++y)
 	{
 		for (int x = 0; x < w; ++x)
 		{
 			//std::cout << "x:" << x << "  y: " << y << "\n";
-			tileSprites.push_back(sf::Sprite(texture));
-			tileSprites.back().setTextureRect(sf::IntRect(x * tileWidth, y * tileHeight, tileWidth, tileHeight));
+			tileSprites.push_back(sf::Sprite(*region.texture));
+			tileSprites.back().setTextureRect(sf::IntRect(region.rect.left + x * tileWidth, region.rect.top + y * tileHeight, tileWidth, tileHeight));
 		}
 	}
 	std::cout << "\n";
@@ -823,38 +920,359 @@ void Level::init()
 
 void Level::fixUpdateOrder()
 {
-	hasSpecificUpdateOrder.clear();
+	hasSpecificUpdateOrder.assign(hasSpecificUpdateOrder.size(), false);
+
+	for (const Entity::Type& type : specificOrderEntitiesPre)
+	{
+		hasSpecificUpdateOrder[type.getID()] = true;
+	}
+	for (const Entity::Type& type : specificOrderEntitiesPost)
+	{
+		hasSpecificUpdateOrder[type.getID()] = true;
+	}
+}
+
+void Level::registerType(const Entity::Type& type)
+{
+	const Entity::Type::ID id = type.getID();
+	if (id >= entities.size())
+	{
+		entities.resize(id + 1);
+		broadphase.resize(id + 1);
+		hasSpecificUpdateOrder.resize(id + 1, false);
+		parallelSafe.resize(id + 1, false);
+	}
+	if (!broadphase[id])
+	{
+		broadphase[id].reset(new SpatialHash(JE_BROADPHASE_CELL_SIZE));
+		updateOrder.push_back(id);
+		updateOrderDirty = true;
+	}
+}
+
+void* Level::allocateEntity(std::size_t typeIndex, std::size_t objectSize)
+{
+	if (parallelPhase)
+	{
+		std::lock_guard<std::mutex> lock(commandMutex);
+		return this->getPool(typeIndex, objectSize).allocate();
+	}
+	return this->getPool(typeIndex, objectSize).allocate();
+}
+
+EntityPool& Level::getPool(std::size_t typeIndex, std::size_t objectSize)
+{
+	if (typeIndex >= pools.size())
+		pools.resize(typeIndex + 1);
+	if (!pools[typeIndex])
+		pools[typeIndex].reset(new EntityPool(objectSize));
+	return *pools[typeIndex];
+}
+
+void Level::insertIntoDepthBuckets(Entity& entity)
+{
+	std::vector<Entity*>& bucket = depthBuckets[entity.depth];
+	entity.depthBucket = &bucket;
+	entity.depthBucketKey = entity.depth;
+	entity.depthBucketIndex = bucket.size();
+	bucket.push_back(&entity);
+}
+
+void Level::removeFromDepthBuckets(Entity& entity)
+{
+	//	left as a hole rather than filled from the back, which would change the draw order
+	(*entity.depthBucket)[entity.depthBucketIndex] = nullptr;
+	holeyDepthBuckets.push_back(entity.depthBucketKey);
+	entity.depthBucket = nullptr;
+}
+
+void Level::compactDepthBuckets()
+{
+	if (holeyDepthBuckets.empty())
+		return;
+	//	lots of Entities at one depth can be destroyed in the same update
+	std::sort(holeyDepthBuckets.begin(), holeyDepthBuckets.end());
+	holeyDepthBuckets.erase(std::unique(holeyDepthBuckets.begin(), holeyDepthBuckets.end()), holeyDepthBuckets.end());
+	for (int depth : holeyDepthBuckets)
+	{
+		auto it = depthBuckets.find(depth);
+		if (it == depthBuckets.end())
+			continue;
+		std::vector<Entity*>& bucket = it->second;
+		std::size_t kept = 0;
+		for (Entity *entity : bucket)
+		{
+			if (entity)
+			{
+				entity->depthBucketIndex = kept;
+				bucket[kept++] = entity;
+			}
+		}
+		bucket.resize(kept);
+		if (bucket.empty())
+			depthBuckets.erase(it);
+	}
+	holeyDepthBuckets.clear();
+}
+
+void Level::updateDepthBucket(Entity& entity)
+{
+	this->removeFromDepthBuckets(entity);
+	this->insertIntoDepthBuckets(entity);
+}
+
+void Level::updateBucket(Entity::Type::ID id)
+{
+	JE_PROFILE_ZONE_DYNAMIC("update " + Entity::Type::fromID(id).getName());
+	if (parallelUpdate && parallelSafe[id] && entities[id].size() >= JE_PARALLEL_MIN_BUCKET)
+	{
+		this->updateBucketParallel(id);
+		return;
+	}
+	//	additions and removals are queued until the end of the update, so the bucket can't change underneath us
+	for (const std::unique_ptr<Entity>& entity : entities[id])
+		entity->update();
+}
+
+void Level::updateBucketParallel(Entity::Type::ID id)
+{
+	std::vector<std::unique_ptr<Entity>>& bucket = entities[id];
+	ThreadPool& pool = game->getThreadPool();
+	//	a few chunks per thread so that threads finishing early can take over some of the work
+	const std::size_t grainSize = std::max<std::size_t>(16, bucket.size() / ((pool.getWorkerCount() + 1) * 4));
+	parallelPhase = true;
+	parallelBucket = id;
+	pool.parallelFor(bucket.size(), grainSize, [&bucket](std::size_t begin, std::size_t end) {
+		for (std::size_t i = begin; i < end; ++i)
+			bucket[i]->update();
+	});
+	parallelPhase = false;
 
-	for (const std::string& type : specificOrderEntitiesPre)
+	//	merge: everything that had to wait until the bucket was no longer being read from other threads
+	JE_PROFILE_ZONE("Level::mergeParallelBucket");
+	for (const std::unique_ptr<Entity>& entity : bucket)
 	{
-		hasSpecificUpdateOrder[type] = true;
+		if (entity->broadphase)
+			entity->broadphase->update(*entity);
+		if (entity->depthBucket && entity->depth != entity->depthBucketKey)
+			this->updateDepthBucket(*entity);
 	}
-	for (const std::string& type : specificOrderEntitiesPost)
+}
+
+void Level::queueDestroy(const Entity& entity)
+{
+	if (parallelPhase)
 	{
-		hasSpecificUpdateOrder[type] = true;
+		std::lock_guard<std::mutex> lock(commandMutex);
+		destroyQueue.push_back(entity.handle);
 	}
+	else
+		destroyQueue.push_back(entity.handle);
+}
+
+void Level::applyCommands()
+{
+	JE_PROFILE_ZONE("Level::applyCommands");
+	//	removals first, so that Entities both added and destroyed this update never make it in
+	if (!destroyQueue.empty())
+	{
+		hasDestroyed.assign(entities.size(), false);
+		for (const HandleTable::Handle& handle : destroyQueue)
+		{
+			Entity *entity = handles.get(handle);
+			//	Entities still in spawnQueue have no broadphase yet
+			if (entity && entity->broadphase)
+			{
+				hasDestroyed[entity->getType().getID()] = true;
+				releasedHandles.push_back(this->detachHandle(*entity));
+			}
+		}
+		destroyQueue.clear();
+	}
+	for (const std::unique_ptr<Entity>& instance : spawnQueue)
+		if (instance->isDead())
+			releasedHandles.push_back(this->detachHandle(*instance));
+	//	every Ref to the removed Entities goes null here in one go, before any of them are deleted
+	handles.release(releasedHandles);
+	releasedHandles.clear();
+
+	for (std::size_t id = 0; id < hasDestroyed.size(); ++id)
+	{
+		if (!hasDestroyed[id])
+			continue;
+		auto& bucket = entities[id];
+		//	stable, unlike swap-removing, so the update order doesn't depend on who died
+		bucket.erase(std::remove_if(bucket.begin(), bucket.end(), [](const std::unique_ptr<Entity>& entity) {
+			return entity->isDead();
+		}), bucket.end());
+	}
+	hasDestroyed.clear();
+
+	if (!spawnQueue.empty())
+	{
+		//	grow each bucket once rather than once per push
+		spawnCounts.assign(EntityType::count(), 0);
+		for (const std::unique_ptr<Entity>& instance : spawnQueue)
+			++spawnCounts[instance->getType().getID()];
+		for (std::size_t id = 0; id < spawnCounts.size(); ++id)
+		{
+			if (spawnCounts[id])
+			{
+				this->registerType(Entity::Type::fromID(id));
+				entities[id].reserve(entities[id].size() + spawnCounts[id]);
+			}
+		}
+		for (std::unique_ptr<Entity>& instance : spawnQueue)
+			if (!instance->isDead())
+				this->addEntity(std::move(instance));
+		//	deletes the ones that died before they were added
+		spawnQueue.clear();
+	}
+}
+
+HandleTable::Handle Level::detachHandle(Entity& entity)
+{
+	const HandleTable::Handle handle = entity.handle;
+	//	so the destructor knows it's already been released
+	entity.handle.table = nullptr;
+	return handle;
+}
+
+std::size_t Level::gatherCandidates(const sf::Rect<int>& bBox, const Entity::Type& type)
+{
+	this->flushMovedEntities();
+	const std::size_t first = queryCandidates.size();
+	const Entity::Type::ID id = type.getID();
+	JE_ASSERT_MSG(!parallelPhase || id != parallelBucket, "Parallel-safe Entities can't query their own type");
+	if (id < broadphase.size() && broadphase[id])
+	{
+		//	a box covering lots of cells compared to how many Entities there are is quicker to brute force
+		const SpatialHash& hash = *broadphase[id];
+		if (hash.prefersScan(bBox))
+			hash.scan(bBox, queryCandidates);
+		else
+			hash.query(bBox, queryCandidates);
+	}
+	return first;
+}
+
+void Level::flushMovedEntities()
+{
+	//	nothing can be queued during the parallel phase, and the broadphase can't be written then
+	if (parallelPhase || movedEntities.empty())
+		return;
+	for (const HandleTable::Handle& moved : movedEntities)
+	{
+		//	Entities removed since they were moved are skipped
+		if (Entity *entity = HandleTable::get(moved))
+			entity->updateMask();
+	}
+	movedEntities.clear();
+}
+
+bool Level::sweepMask(RayCastResult& result, const CollisionMask& mask, const Entity *caller, const Entity::Type& type, const sf::Vector2f& veloc, const std::function<bool(Entity&)>& filter)
+{
+	const Entity::Type::ID id = type.getID();
+	JE_ASSERT_MSG(!parallelPhase || id != parallelBucket, "Parallel-safe Entities can't query their own type");
+	this->flushMovedEntities();
+	if (id >= broadphase.size() || !broadphase[id])
+		return false;
+	Entity *hitEntity = nullptr;
+	DetailedMask::SweepHit best;
+	best.time = 2.f;
+	broadphase[id]->sweep(mask.getAABB(), veloc, [&](Entity& entity) -> float {
+		if (&entity != caller && (!filter || filter(entity)))
+		{
+			entity.updateMask();
+			DetailedMask::SweepHit hit;
+			if (mask.sweep(entity.getMask(), veloc, hit) && hit.time < best.time)
+			{
+				best = hit;
+				hitEntity = &entity;
+			}
+		}
+		return best.time;
+	});
+	if (!hitEntity)
+		return false;
+	result.entity = Ref<Entity>(*hitEntity);
+	result.time = best.time;
+	result.contact = best.contact;
+	result.normal = best.normal;
+	return true;
 }
 
 void Level::drawEntities(sf::RenderTarget& target, const sf::Rect<int>& cameraBounds) const
 {
+	JE_PROFILE_ZONE("Level::drawEntities");
 	auto& tiles = const_cast<decltype(tileLayers)&>(tileLayers);
 	for (auto& grid : tiles)
 	{
 		grid.second->setVisibleArea(cameraBounds);
 	}
 
+	drawStats.cameras.push_back(DrawStats::CameraStats());
+	DrawStats::CameraStats& cameraStats = drawStats.cameras.back();
+	cameraStats.drawn = 0;
+	cameraStats.culled = 0;
+	//	a plain rectangle test per Entity, which is far cheaper than drawing it for every camera
+	auto isVisible = [&](const Entity *entity) -> bool
+	{
+		if (cameraCulling && isCulled(entity->getDrawBounds(), cameraBounds))
+		{
+			++cameraStats.culled;
+			return false;
+		}
+		++cameraStats.drawn;
+		return true;
+	};
+
 	this->beforeDraw(target);
-	for (Entity *entity : depthBuffer)
+	if (batchedDrawing)
 	{
-		//states.transform *= entity->transform().getTransform();
-		entity->draw(target, states);
+		for (const auto& bucket : depthBuckets)
+		{
+			for (const Entity *entity : bucket.second)
+			{
+				//	holes left by Entities removed since the last compactDepthBuckets()
+				if (!entity || !isVisible(entity))
+					continue;
+				if (entity->drawBatched(batch))
+				{
+					++drawStats.batchedEntities;
+					continue;
+				}
+				//	anything batched so far is underneath this
+				drawStats.drawCalls += batch.flush(target, states) + 1;
+				++drawStats.unbatchedEntities;
+				entity->draw(target, states);
+			}
+			batch.endLayer();
+		}
+		drawStats.drawCalls += batch.flush(target, states);
+	}
+	else
+	{
+		for (const auto& bucket : depthBuckets)
+		{
+			for (const Entity *entity : bucket.second)
+			{
+				//	holes left by Entities removed since the last compactDepthBuckets()
+				if (!entity || !isVisible(entity))
+					continue;
+				//states.transform *= entity->transform().getTransform();
+				entity->draw(target, states);
+				++drawStats.drawCalls;
+				++drawStats.unbatchedEntities;
+			}
+		}
 	}
 	this->onDraw(target);
 
 #ifdef JE_DEBUG
-	for (auto& p : entities)
+	for (auto& bucket : entities)
 	{
-		for (const std::unique_ptr<Entity>& entity : p.second)
+		for (const std::unique_ptr<Entity>& entity : bucket)
 			//if (cameraBounds.contains(entity->getPos().x + cameraBounds.width / 2, entity->getPos().y + cameraBounds.height / 2))
 				entity->debugDraw(target);
 		for (const sf::RectangleShape& rect : debugDrawRects)
@@ -1,15 +1,23 @@
 #ifndef JE_LEVEL_HPP
 #define JE_LEVEL_HPP
 
+#include <cstddef>
 #include <functional>
 #include <initializer_list>
 #include <map>
+#include <mutex>
+#include <new>
 #include <string>
+#include <utility>
 #include <vector>
 #include <SFML/Graphics/RenderStates.hpp>
 #include "jam-engine/Core/Entity.hpp"
+#include "jam-engine/Core/EntityPool.hpp"
+#include "jam-engine/Core/HandleTable.hpp"
 #include "jam-engine/Core/Ref.hpp"
+#include "jam-engine/Graphics/SpriteBatch.hpp"
 #include "jam-engine/Graphics/TileGrid.hpp"
+#include "jam-engine/Physics/SpatialHash.hpp"
 
 namespace je
 {
@@ -71,6 +79,21 @@ public:
 
 	void findCollisions(std::vector<Ref<Entity>>& results, const sf::Rect<int>& bBox, Entity::Type type, std::function<bool(Entity&)> filter);
 
+	//!The first thing a rayCast() ran into
+	struct RayCastResult
+	{
+		//!The Entity that was hit
+		Ref<Entity> entity;
+		//!How far along veloc the hit happened, from 0 to 1
+		float time;
+		//!Where the caller (or ray) was when it hit
+		sf::Vector2f position;
+		//!The point of contact
+		sf::Vector2f contact;
+		//!The unit surface normal of the Entity that was hit, facing back towards the caller
+		sf::Vector2f normal;
+	};
+
 	/**
 	 * Attempts to move along the velocity vector until it hits an entity of the given type.
 	 * @param caller The Entity to use as a reference to query from
@@ -82,11 +105,37 @@ public:
 
 	sf::Vector2f rayCast(const Entity *caller, Entity::Type type, const sf::Vector2f& veloc, std::function<bool(Entity&)> filter);
 
+	/**
+	 * Sweeps the caller's collision mask along the velocity vector and finds the first Entity of
+	 * the given type it would run into. This is exact (no stepping), and only looks at Entities
+	 * near the path. Only touching/sliding along an Entity doesn't count as hitting it.
+	 * @param result Set to the details of the hit if there was one
+	 * @param caller The Entity to sweep
+	 * @param type The type of Entity to stop at
+	 * @param veloc How far to move the caller
+	 * @param filter Entities it returns false for are ignored (optional)
+	 * @return Whether anything was hit
+	 */
+	bool rayCast(RayCastResult& result, const Entity *caller, Entity::Type type, const sf::Vector2f& veloc, std::function<bool(Entity&)> filter = nullptr);
+
+	/**
+	 * Casts a ray from a point and finds the first Entity of the given type that it hits
+	 * @param result Set to the details of the hit if there was one
+	 * @param start Where the ray starts
+	 * @param type The type of Entity to stop at
+	 * @param veloc The direction and length of the ray
+	 * @param filter Entities it returns false for are ignored (optional)
+	 * @return Whether anything was hit
+	 */
+	bool rayCast(RayCastResult& result, const sf::Vector2f& start, Entity::Type type, const sf::Vector2f& veloc, std::function<bool(Entity&)> filter = nullptr);
+
 	sf::Vector2f rayCastManually(bool& hit, const Entity *caller, std::initializer_list<Entity::Type> types, std::function<bool(Entity&)> filter, const sf::Vector2f& veloc, float stepSize = 1.f);
 
 
 	/**
-	 * Adds an Entity into the Level. The Level now assumes ownership of the Entity
+	 * Adds an Entity into the Level. The Level now assumes ownership of the Entity.
+	 * Entities added during update() are queued and join the Level all at once when it finishes,
+	 * so they aren't updated or found by collision queries until the next update.
 	 * @param instance The Entity to add
 	 * @return Reference to the entitiy added
 	 */
@@ -95,6 +144,16 @@ public:
 	// DEPRECATED !!!
 	void addEntity(Entity *instance);
 
+	/**
+	 * Constructs an Entity of type T in the Level's pool for T and adds it to the Level.
+	 * Prefer this over addEntity() for anything spawned often, since it recycles the memory of
+	 * destroyed Entities of the same type instead of going through the heap.
+	 * @param args The arguments to pass to T's constructor
+	 * @return Reference to the entity added
+	 */
+	template <typename T, typename... Args>
+	Ref<T> emplaceEntity(Args&&... args);
+
 	/**
 	 * Destroys everything in the level
 	 */
@@ -135,7 +194,7 @@ public:
 	 * initializer list. The order of things outside of here is lexicographical.
 	 * @param order The order for entities in this category
 	 */
-	void setSpecificOrderEntitiesPre(std::initializer_list<std::string> order);
+	void setSpecificOrderEntitiesPre(std::initializer_list<Entity::Type> order);
 
 	/**
 	 * Sets the order of any Entities which are to be updated after all others
@@ -143,7 +202,76 @@ public:
 	 * initializer list. The order of things outside of here is lexicographical.
 	 * @param order The order for entities in this category
 	 */
-	void setSpecificOrderEntitiesPost(std::initializer_list<std::string> order);
+	void setSpecificOrderEntitiesPost(std::initializer_list<Entity::Type> order);
+
+	/**
+	 * Turns on updating the types marked by setParallelSafe() across the Game's thread pool.
+	 * Each type's Entities are still updated together, and types still update in the usual
+	 * order, so setSpecificOrderEntitiesPre/Post() mean the same thing either way.
+	 * @param enabled Whether to update in parallel (off by default)
+	 */
+	void setParallelUpdate(bool enabled);
+
+	/**
+	 * Marks types whose onUpdate() is safe to run on several Entities at once. Such an Entity
+	 * may only modify itself, but may destroy() any Entity and add Entities, since both of those
+	 * are queued until the end of the update anyway. Collision queries see the other Entities
+	 * as they were before the type started updating, and must not query the Entity's own type.
+	 * @param types The types that are safe to update in parallel
+	 */
+	void setParallelSafe(std::initializer_list<Entity::Type> types);
+
+	/**
+	 * @return Whether this is being called while a parallel-safe type is updating
+	 */
+	bool isUpdatingInParallel() const;
+
+	//!What the last draw() did
+	struct DrawStats
+	{
+		DrawStats()
+			:drawCalls(0)
+			,batchedEntities(0)
+			,unbatchedEntities(0)
+			,cameras()
+		{
+		}
+
+		//!Entities drawn and culled for one camera
+		struct CameraStats
+		{
+			unsigned int drawn;
+			unsigned int culled;
+		};
+
+		//!Draw calls made by the batch, plus one for each Entity drawn with draw() (it may make more)
+		unsigned int drawCalls;
+		//!Entities that went through the batch
+		unsigned int batchedEntities;
+		//!Entities drawn with their own draw()
+		unsigned int unbatchedEntities;
+		//!In the order the cameras were registered, or just one for the whole Level if there are none
+		std::vector<CameraStats> cameras;
+	};
+
+	/**
+	 * Turns on drawing Entities with Entity::drawBatched(), so that those using the same
+	 * texture at consecutive depths share a draw call rather than taking a draw call each.
+	 * @param enabled Whether to batch (off by default)
+	 */
+	void setBatchedDrawing(bool enabled);
+
+	/**
+	 * Turns on skipping Entities whose Entity::getDrawBounds() are outside of the camera
+	 * being drawn (or the default view without cameras), so that each camera only pays for
+	 * what it can see. Entities that draw outside of their mask need to override
+	 * Entity::getDrawBounds() first, or they'll vanish near the edges of the screen.
+	 * Empty bounds are never culled.
+	 * @param enabled Whether to cull (off by default)
+	 */
+	void setCameraCulling(bool enabled);
+
+	const DrawStats& getDrawStats() const;
 
 
 	void registerCamera(const Camera *camera);
@@ -204,30 +332,145 @@ protected:
 
 
 
-	std::map<std::string, std::vector<std::unique_ptr<Entity>>> entities;
+	/**
+	 * @param type The type of Entity to get
+	 * @return All Entities of that type in the Level (empty if the Level has never had any)
+	 */
+	const std::vector<std::unique_ptr<Entity>>& getEntities(const Entity::Type& type) const;
+
+	//!Indexed by Entity::Type::getID()
+	std::vector<std::vector<std::unique_ptr<Entity>>> entities;
 	std::map<std::string, TileGrid*> tileLayers;
 	mutable sf::RenderStates states;
 
 private:
 	void init();
 	void fixUpdateOrder();
+	/**
+	 * Makes room for the given type in all the per-type arrays if it hasn't been seen by this Level yet
+	 */
+	void registerType(const Entity::Type& type);
+	void updateBucket(Entity::Type::ID id);
+	/**
+	 * Updates the bucket across the thread pool, then catches up on the broadphase and depth
+	 * changes that updating it serially would have done along the way
+	 */
+	void updateBucketParallel(Entity::Type::ID id);
+	/**
+	 * Queues the Entity to be removed by applyCommands(). Called once per Entity by destroy()
+	 */
+	void queueDestroy(const Entity& entity);
+	/**
+	 * Removes the Entities destroyed and adds the Entities queued since the last call, in one batch.
+	 * Removal keeps the update order of the survivors intact.
+	 */
+	void applyCommands();
+	/**
+	 * @return The Entity's Handle, which the Entity will no longer release itself
+	 */
+	HandleTable::Handle detachHandle(Entity& entity);
+	/**
+	 * @return Memory from the pool for the given C++ type, even from inside a parallel update
+	 */
+	void* allocateEntity(std::size_t typeIndex, std::size_t objectSize);
+	EntityPool& getPool(std::size_t typeIndex, std::size_t objectSize);
+	void insertIntoDepthBuckets(Entity& entity);
+	void removeFromDepthBuckets(Entity& entity);
+	//!Closes up the holes removeFromDepthBuckets() leaves, keeping the order of what's left
+	void compactDepthBuckets();
+	/**
+	 * Moves the Entity to the bucket for its current depth. O(log(distinct depths)), independent of the Entity count
+	 */
+	void updateDepthBucket(Entity& entity);
 	void drawEntities(sf::RenderTarget& target, const sf::Rect<int>& cameraBounds) const;
+	/**
+	 * Appends the broadphase candidates of the given type near bBox to this thread's queryCandidates
+	 * @return The index of the first appended candidate. Resize queryCandidates back to it when done.
+	 */
+	std::size_t gatherCandidates(const sf::Rect<int>& bBox, const Entity::Type& type);
+	//!Refiles the Entities moved by something other than their own update() in the broadphase
+	void flushMovedEntities();
+	/**
+	 * Sweeps mask along veloc through the broadphase for type and keeps the earliest hit
+	 */
+	bool sweepMask(RayCastResult& result, const CollisionMask& mask, const Entity *caller, const Entity::Type& type, const sf::Vector2f& veloc, const std::function<bool(Entity&)>& filter);
 
 
 	std::vector<sf::Sprite> tileSprites;
 	int width;
 	int height;
 	Game * const game;
-	std::vector<Entity*> depthBuffer;
-	std::vector<std::string> specificOrderEntitiesPre;
-	std::vector<std::string> specificOrderEntitiesPost;
-	std::map<std::string, bool> hasSpecificUpdateOrder;
+	//!Every Entity in the Level keyed by depth, so iterating in order is back to front
+	std::map<int, std::vector<Entity*>, std::greater<int>> depthBuckets;
+	//!The depths of buckets with holes in them (nullptrs), with repeats
+	std::vector<int> holeyDepthBuckets;
+	//!Backs every Ref to an Entity in this Level. Entities allocate their slot when constructed
+	HandleTable handles;
+	//!Indexed by EntityPool::typeIndex<T>() for the C++ type T of the pooled Entities
+	std::vector<std::unique_ptr<EntityPool>> pools;
+	//!Indexed by Entity::Type::getID(). nullptr for types this Level has never seen
+	std::vector<std::unique_ptr<SpatialHash>> broadphase;
+	std::vector<Entity::Type> specificOrderEntitiesPre;
+	std::vector<Entity::Type> specificOrderEntitiesPost;
+	//!Indexed by Entity::Type::getID()
+	std::vector<bool> hasSpecificUpdateOrder;
+	//!The IDs of every type this Level has seen, sorted by name at the start of update() if updateOrderDirty
+	std::vector<Entity::Type::ID> updateOrder;
+	bool updateOrderDirty;
+	bool parallelUpdate;
+	//!Indexed by Entity::Type::getID()
+	std::vector<bool> parallelSafe;
+	//!Whether a parallel-safe bucket is being updated right now
+	bool parallelPhase;
+	Entity::Type::ID parallelBucket;
+	//!Whether addEntity() and destroy() are being queued, which is for the whole of update()
+	bool updating;
+	//!Entities added during update(), added for real by applyCommands()
+	std::vector<std::unique_ptr<Entity>> spawnQueue;
+	//!Handles rather than pointers so that Entities freed in the meantime (eg by clear()) are skipped
+	std::vector<HandleTable::Handle> destroyQueue;
+	//!Entities moved through Entity::transform() by something else, which flushMovedEntities() refiles
+	std::vector<HandleTable::Handle> movedEntities;
+	//!Guards the queues and pools during the parallel phase
+	std::mutex commandMutex;
+	//!Scratch space for applyCommands(), indexed by Entity::Type::getID()
+	std::vector<unsigned int> spawnCounts;
+	std::vector<bool> hasDestroyed;
+	std::vector<HandleTable::Handle> releasedHandles;
 	std::vector<const Camera*> cameras;// maintains no ownership
+	bool batchedDrawing;
+	bool cameraCulling;
+	//!Only used during drawEntities(), but kept between frames to reuse its memory
+	mutable SpriteBatch batch;
+	mutable DrawStats drawStats;
 #ifdef JE_DEBUG
 	std::vector<sf::RectangleShape> debugDrawRects;
 #endif
+
+	friend class Entity;
 };
 
+template <typename T, typename... Args>
+Ref<T> Level::emplaceEntity(Args&&... args)
+{
+	static_assert(alignof(T) <= alignof(std::max_align_t), "Entity type is over-aligned for EntityPool");
+	void *memory = this->allocateEntity(EntityPool::typeIndex<T>(), sizeof(T));
+	T *instance;
+	try
+	{
+		//	global placement new, since Entity's own operator new would hide it
+		instance = ::new (memory) T(std::forward<Args>(args)...);
+	}
+	catch (...)
+	{
+		//	the block would otherwise never go back on the free list
+		EntityPool::release(memory);
+		throw;
+	}
+	this->addEntity(std::unique_ptr<Entity>(instance));
+	return Ref<T>(*instance);
+}
+
 } // je
 
 #endif // JE_LEVEL_HPP
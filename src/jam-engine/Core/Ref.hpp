@@ -1,13 +1,20 @@
 #ifndef JE_REF_HPP
 #define JE_REF_HPP
 
-#include <memory>
+#include <cstddef>
 
 #include "jam-engine/Core/Entity.hpp"
+#include "jam-engine/Core/HandleTable.hpp"
 
 namespace je
 {
 
+/**
+ * A weak reference to an Entity that becomes null once the Entity is destroyed.
+ * It's just a slot index plus generation in the Level's HandleTable, so copying is free
+ * and checking whether the Entity is alive is a single table lookup. Safe to use after the
+ * Level is gone, when it's always null.
+ */
 template <typename EntityType>
 class Ref
 {
@@ -16,7 +23,8 @@ public:
 
 	Ref(EntityType& entity);
 
-	Ref(const Ref<Entity>& copy);
+	template <typename OtherType>
+	Ref(const Ref<OtherType>& copy);
 
 	EntityType& operator*() const;
 
@@ -36,75 +44,75 @@ public:
 
 	operator EntityType*() const;
 
-	Ref<EntityType>& operator=(const Ref<Entity>& rhs);
+	template <typename OtherType>
+	Ref<EntityType>& operator=(const Ref<OtherType>& rhs);
 
 	Ref<EntityType>& operator=(std::nullptr_t);
 
 //private:
+	/**
+	 * @return The Entity if it's still alive, otherwise nullptr
+	 */
+	EntityType* get() const;
 
-	EntityType *entity;
-
-	std::shared_ptr<bool> isAlive;
-
-	//template <typename OtherType>
-	//friend class Ref<OtherType>; // this is dumb
+	HandleTable::Handle handle;
 };
 
 template <typename EntityType>
 Ref<EntityType>::Ref()
-	:entity(nullptr)
-	,isAlive(new bool(false))
 {
+	handle.table = nullptr;
+	handle.index = 0;
+	handle.generation = 0;
 }
 
 
 template <typename EntityType>
 Ref<EntityType>::Ref(EntityType& entity)
-	:entity(&entity)
-	,isAlive(entity.aliveRef())
+	:handle(entity.getHandle())
 {
 }
 
 
 template <typename EntityType>
-Ref<EntityType>::Ref(const Ref<Entity>& copy)
-	:entity(static_cast<EntityType*>(copy.entity))
-	,isAlive(copy.isAlive)
+template <typename OtherType>
+Ref<EntityType>::Ref(const Ref<OtherType>& copy)
+	:handle(copy.handle)
 {
 }
 
 template <typename EntityType>
 EntityType& Ref<EntityType>::operator*() const
 {
-	return *entity;
+	return *get();
 }
 
 
 template <typename EntityType>
 EntityType* Ref<EntityType>::operator->() const
 {
-	return *isAlive ? entity : nullptr;
+	return get();
 }
 
 
 template <typename EntityType>
 Ref<EntityType>::operator bool() const
 {
-	return *isAlive;
+	return get() != nullptr;
 }
 
 
 template <typename EntityType>
 bool Ref<EntityType>::operator==(std::nullptr_t) const
 {
-	return !*isAlive;
+	return get() == nullptr;
 }
 
 
 template <typename EntityType>
 bool Ref<EntityType>::operator!=(std::nullptr_t) const
 {
-	return *isAlive;
+	return get() != nullptr;
 }
 
 
@@ -112,7 +120,8 @@ template <typename EntityType>
 template <typename RHSType>
 bool Ref<EntityType>::operator==(const Ref<RHSType>& rhs) const
 {
-	return (!*isAlive && !*rhs.isAlive) || (*isAlive && *rhs.isAlive && entity == rhs.entity);
+	//	two dead references compare equal, same as before
+	return static_cast<const Entity*>(get()) == static_cast<const Entity*>(rhs.get());
 }
 
 
@@ -120,34 +129,36 @@ template <typename EntityType>
 template <typename RHSType>
 bool Ref<EntityType>::operator!=(const Ref<RHSType>&rhs) const
 {
-	return (*isAlive != *rhs.isAlive) || (*isAlive && *rhs.isAlive && entity != rhs.entity);
+	return static_cast<const Entity*>(get()) != static_cast<const Entity*>(rhs.get());
 }
 
 template <typename EntityType>
 Ref<EntityType>::operator EntityType*() const
 {
-	return *isAlive ? entity : nullptr;
+	return get();
 }
 
 template <typename EntityType>
-Ref<EntityType>& Ref<EntityType>::operator=(const Ref<Entity>& rhs)
+template <typename OtherType>
+Ref<EntityType>& Ref<EntityType>::operator=(const Ref<OtherType>& rhs)
 {
-	entity = static_cast<EntityType*>(rhs.entity);
-	isAlive = rhs.isAlive;
+	handle = rhs.handle;
 	return *this;
 }
 
 template <typename EntityType>
 Ref<EntityType>& Ref<EntityType>::operator=(std::nullptr_t)
 {
-	if (entity)
-	{
-		entity = nullptr;
-		isAlive.reset(new bool(false));
-	}
+	handle.table = nullptr;
 	return *this;
 }
 
+template <typename EntityType>
+EntityType* Ref<EntityType>::get() const
+{
+	return handle.table ? static_cast<EntityType*>(HandleTable::get(handle)) : nullptr;
+}
+
 } // je
 
-#endif // JE_REF_HPP
\ No newline at end of file
+#endif // JE_REF_HPP
@@ -6,22 +6,34 @@ namespace je
 {
 
 Animation::Animation(const sf::Texture& texture, int width, int height, int time, bool repeat)
-	:sprite(texture, sf::IntRect(0, 0, width, height))
+	:Animation(TextureRegion(texture), width, height, time, repeat)
+{
+}
+
+Animation::Animation(const sf::Texture& texture, int width, int height, std::initializer_list<unsigned int> times, bool repeat)
+	:Animation(TextureRegion(texture), width, height, times, repeat)
+{
+}
+
+Animation::Animation(const TextureRegion& region, int width, int height, int time, bool repeat)
+	:sprite(*region.texture, sf::IntRect(region.rect.left, region.rect.top, width, height))
+	,regionPos(region.rect.left, region.rect.top)
 	,frameProgress(0)
 	,frame(0)
 	,repeating(repeat)
 	,width(width)
 	,height(height)
 {
-	const int length = texture.getSize().x / width;
+	const int length = region.rect.width / width;
 	for (int i = 0, x = 0; i < length; ++i, x += width)
 	{
 		lengths.push_back(time);
 	}
 }
 
-Animation::Animation(const sf::Texture& texture, int width, int height, std::initializer_list<unsigned int> times, bool repeat)
-	:sprite(texture, sf::IntRect(0, 0, width, height))
+Animation::Animation(const TextureRegion& region, int width, int height, std::initializer_list<unsigned int> times, bool repeat)
+	:sprite(*region.texture, sf::IntRect(region.rect.left, region.rect.top, width, height))
+	,regionPos(region.rect.left, region.rect.top)
 	,frameProgress(0)
 	,frame(0)
 	,repeating(repeat)
@@ -85,7 +97,7 @@ void Animation::draw(sf::RenderTarget& target, sf::RenderStates states) const
 /*					private					*/
 void Animation::updateTextureRect()
 {
-	sprite.setTextureRect(sf::IntRect(width * frame, 0, width, height));
+	sprite.setTextureRect(sf::IntRect(regionPos.x + width * frame, regionPos.y, width, height));
 }
 
 } // je
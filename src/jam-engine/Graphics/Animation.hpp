@@ -6,6 +6,8 @@
 #include <initializer_list>
 #include <SFML/Graphics.hpp>
 
+#include "jam-engine/Graphics/TextureRegion.hpp"
+
 namespace je
 {
 //	TODO: make not shit
@@ -15,6 +17,13 @@ public:
 	Animation(const sf::Texture& texture, int width, int height, int time, bool repeat = true);
 	Animation(const sf::Texture& texture, int width, int height, std::initializer_list<unsigned int> times, bool repeat = true);
 
+	/**
+	 * For strips in part of a texture, such as from TexManager::getRegion(). The frames go
+	 * left to right from the top left of the region.
+	 */
+	Animation(const TextureRegion& region, int width, int height, int time, bool repeat = true);
+	Animation(const TextureRegion& region, int width, int height, std::initializer_list<unsigned int> times, bool repeat = true);
+
 
 	bool isFinished() const;
 
@@ -32,6 +41,8 @@ private:
 	void updateTextureRect();
 
 	sf::Sprite sprite;
+	//!Where the first frame is in the texture
+	sf::Vector2i regionPos;
 	std::vector<unsigned int> lengths;
 	unsigned int frameProgress;
 	unsigned int frame;
@@ -0,0 +1,91 @@
+#include "jam-engine/Graphics/SpriteBatch.hpp"
+
+namespace je
+{
+
+SpriteBatch::SpriteBatch()
+	:runs()
+	,runCount(0)
+	,layerStart(0)
+	,queued(0)
+{
+}
+
+void SpriteBatch::add(const sf::Texture& texture, const sf::IntRect& rect, const sf::Transform& transform, sf::Color color)
+{
+	//	quads in the same layer can go in any order, so look for a run with the same texture to join.
+	//	the last run is drawn last anyway, so it can be joined even from a later layer, which keeps
+	//	layers of the same texture (say, one per depth in a y-sorted game) to one draw call
+	std::size_t first = layerStart;
+	if (first == runCount && first > 0)
+		--first;
+	Run *run = nullptr;
+	for (std::size_t i = first; i < runCount; ++i)
+	{
+		if (runs[i].texture == &texture)
+		{
+			run = &runs[i];
+			break;
+		}
+	}
+	if (!run)
+	{
+		if (runCount == runs.size())
+			runs.emplace_back();
+		run = &runs[runCount++];
+		run->texture = &texture;
+		run->vertices.clear();
+	}
+
+	const float width = rect.width < 0 ? -rect.width : rect.width;
+	const float height = rect.height < 0 ? -rect.height : rect.height;
+	const float left = rect.left;
+	const float top = rect.top;
+	const float right = rect.left + rect.width;
+	const float bottom = rect.top + rect.height;
+	run->vertices.push_back(sf::Vertex(transform.transformPoint(0.f, 0.f), color, sf::Vector2f(left, top)));
+	run->vertices.push_back(sf::Vertex(transform.transformPoint(width, 0.f), color, sf::Vector2f(right, top)));
+	run->vertices.push_back(sf::Vertex(transform.transformPoint(width, height), color, sf::Vector2f(right, bottom)));
+	run->vertices.push_back(sf::Vertex(transform.transformPoint(0.f, height), color, sf::Vector2f(left, bottom)));
+	++queued;
+}
+
+void SpriteBatch::add(const TextureRegion& region, const sf::Transform& transform, sf::Color color)
+{
+	if (region.texture)
+		this->add(*region.texture, region.rect, transform, color);
+}
+
+void SpriteBatch::add(const sf::Sprite& sprite)
+{
+	if (sprite.getTexture())
+		this->add(*sprite.getTexture(), sprite.getTextureRect(), sprite.getTransform(), sprite.getColor());
+}
+
+void SpriteBatch::endLayer()
+{
+	layerStart = runCount;
+}
+
+unsigned int SpriteBatch::flush(sf::RenderTarget& target, sf::RenderStates states)
+{
+	unsigned int drawCalls = 0;
+	for (std::size_t i = 0; i < runCount; ++i)
+	{
+		const Run& run = runs[i];
+		states.texture = run.texture;
+		target.draw(&run.vertices[0], run.vertices.size(), sf::PrimitiveType::Quads, states);
+		++drawCalls;
+	}
+	runCount = 0;
+	layerStart = 0;
+	queued = 0;
+	return drawCalls;
+}
+
+std::size_t SpriteBatch::getQueuedCount() const
+{
+	return queued;
+}
+
+} // je
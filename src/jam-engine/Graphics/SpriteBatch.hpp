@@ -0,0 +1,82 @@
+#ifndef JE_SPRITE_BATCH_HPP
+#define JE_SPRITE_BATCH_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include <SFML/Graphics/Color.hpp>
+#include <SFML/Graphics/Rect.hpp>
+#include <SFML/Graphics/RenderStates.hpp>
+#include <SFML/Graphics/RenderTarget.hpp>
+#include <SFML/Graphics/Sprite.hpp>
+#include <SFML/Graphics/Texture.hpp>
+#include <SFML/Graphics/Transform.hpp>
+#include <SFML/Graphics/Vertex.hpp>
+
+#include "jam-engine/Graphics/TextureRegion.hpp"
+
+namespace je
+{
+
+/**
+ * Collects textured quads and draws them with one draw call per texture instead of one per quad.
+ * Quads between two calls to endLayer() may be drawn in any order, so the Level only batches quads
+ * from Entities of the same depth together, and draws everything batched so far (flush()) before
+ * any Entity that draws itself.
+ */
+class SpriteBatch
+{
+public:
+	SpriteBatch();
+
+	/**
+	 * Queues a quad the size of rect, drawn at transform
+	 * @param texture Must stay alive until the next flush()
+	 * @param rect The part of the texture to draw
+	 * @param transform Where to draw it, as for a sprite (so position, rotation, scale and origin)
+	 * @param color Multiplied with the texture, as for a sprite
+	 */
+	void add(const sf::Texture& texture, const sf::IntRect& rect, const sf::Transform& transform, sf::Color color = sf::Color::White);
+
+	/**
+	 * Queues a quad the size of region, such as one from TexManager::getRegion()
+	 */
+	void add(const TextureRegion& region, const sf::Transform& transform, sf::Color color = sf::Color::White);
+
+	/**
+	 * Queues a sprite with its current texture, rect, transform and colour
+	 */
+	void add(const sf::Sprite& sprite);
+
+	//!Stops anything added after this from being drawn before anything added before it
+	void endLayer();
+
+	/**
+	 * Draws everything queued, one draw call per texture per layer (at most, since a layer's
+	 * first quads join the last layer's last run if they share its texture), then empties the batch
+	 * @param states Any texture in it is replaced by the batch's textures
+	 * @return How many draw calls that took
+	 */
+	unsigned int flush(sf::RenderTarget& target, sf::RenderStates states = sf::RenderStates::Default);
+
+	//!How many quads are waiting to be drawn
+	std::size_t getQueuedCount() const;
+
+private:
+	struct Run
+	{
+		const sf::Texture *texture;
+		std::vector<sf::Vertex> vertices;
+	};
+
+	//!Kept (with their vertex storage) between flushes, only the first runCount are in use
+	std::vector<Run> runs;
+	std::size_t runCount;
+	//!The first run that quads added now may be merged into
+	std::size_t layerStart;
+	std::size_t queued;
+};
+
+} // je
+
+#endif // JE_SPRITE_BATCH_HPP
@@ -4,23 +4,73 @@
 	#include <iostream>
 #endif
 
+#include <chrono>
+#include <fstream>
 #include <iostream>
+
+#include "jam-engine/Core/Game.hpp"
+#include "jam-engine/Utility/Assert.hpp"
+#include "jam-engine/Utility/Profiler.hpp"
+#include "jam-engine/Utility/ThreadPool.hpp"
+
 namespace je
 {
 
-TexManager::TexManager()
-	:path("img/")
+TexManager::Handle::Handle()
+	:pending()
+{
+}
+
+TexManager::Handle::Handle(std::shared_ptr<const Pending> pending)
+	:pending(std::move(pending))
+{
+}
+
+bool TexManager::Handle::isReady() const
+{
+	return pending && pending->ready;
+}
+
+const TextureRegion& TexManager::Handle::getRegion() const
+{
+	JE_ASSERT_MSG(isReady(), "texture hasn't finished loading");
+	return pending->region;
+}
+
+TexManager::TexManager(Game *game)
+	:game(game)
+	,textures()
+	,bitmaps()
+	,atlas()
+	,regions()
+	,pending()
+	,uploadBudget(JE_TEXTURE_UPLOAD_BUDGET)
+	,path("img/")
 {
 }
     
 
     const sf::Texture& TexManager::get(const std::string& id)
     {
+        //  finishing it off is quicker than starting again
+        if (std::shared_ptr<Pending> loading = findPending(id))
+        {
+            //  a packed image only goes in the atlas, so its own texture has to be made while the pixels are still here
+            loading->decoded.wait();
+            if (loading->pack)
+                textures[id].loadFromImage(loading->image);
+            this->finish(loading);
+        }
         auto it = textures.find(id);
         if (it == textures.end())
         {
             it = textures.emplace(std::pair<std::string, sf::Texture>(id, sf::Texture())).first;
-            it->second.loadFromFile(path + id);
+            auto packed = regions.find(id);
+            //  already in the atlas, so read it back from there rather than from the disk
+            if (packed != regions.end())
+                it->second.loadFromImage(packed->second.texture->copyToImage(), packed->second.rect);
+            else
+                it->second.loadFromFile(path + id);
             std::cout << path << "" << id << std::endl;
 #ifdef JE_DEBUG
             std::cout << "Loaded " << id << std::endl;
@@ -29,11 +79,192 @@ TexManager::TexManager()
         return (it->second);
     }
 
+const TextureRegion& TexManager::getRegion(const std::string& id)
+{
+	if (std::shared_ptr<Pending> loading = findPending(id))
+		this->finish(loading);
+	auto it = regions.find(id);
+	if (it != regions.end())
+		return it->second;
+	//	already loaded on its own, so packing it too would just load it twice
+	auto loaded = textures.find(id);
+	if (loaded != textures.end())
+		return regions.emplace(id, TextureRegion(loaded->second)).first->second;
+	sf::Image image;
+	image.loadFromFile(path + id);
+	this->store(id, image, true);
+	return regions[id];
+}
+
+TexManager::Handle TexManager::loadAsync(const std::string& id, bool pack)
+{
+	if (std::shared_ptr<Pending> loading = findPending(id))
+		return Handle(loading);
+	std::shared_ptr<Pending> request = std::make_shared<Pending>();
+	request->id = id;
+	request->pack = pack;
+	request->decoded = request->decodedPromise.get_future().share();
+	request->ready = false;
+
+	auto packed = regions.find(id);
+	auto loaded = textures.find(id);
+	if (pack && packed != regions.end())
+		request->region = packed->second;
+	else if (loaded != textures.end())
+		request->region = TextureRegion(loaded->second);
+	if (request->region.texture)
+	{
+		request->decodedPromise.set_value();
+		request->ready = true;
+		return Handle(request);
+	}
+
+	const std::string filename = path + id;
+	auto decode = [request, filename]()
+	{
+		request->image.loadFromFile(filename);
+		request->decodedPromise.set_value();
+	};
+	if (game)
+		game->getThreadPool().submit(decode);
+	else
+		decode();
+	pending.push_back(request);
+	return Handle(request);
+}
+
+void TexManager::preload(const std::vector<std::string>& ids, bool pack)
+{
+	for (const std::string& id : ids)
+		this->loadAsync(id, pack);
+}
+
+bool TexManager::preloadManifest(const std::string& filename, bool pack)
+{
+	std::ifstream manifest(filename.c_str());
+	if (!manifest)
+		return false;
+	std::string id;
+	while (std::getline(manifest, id))
+	{
+		//	for manifests saved with Windows line endings
+		if (!id.empty() && id.back() == '\r')
+			id.pop_back();
+		if (!id.empty())
+			this->loadAsync(id, pack);
+	}
+	return true;
+}
+
+void TexManager::uploadPending(double budget)
+{
+	JE_PROFILE_ZONE("TexManager::uploadPending");
+	if (budget <= 0.0)
+		budget = uploadBudget;
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (std::size_t i = 0; i < pending.size(); )
+	{
+		if (pending[i]->decoded.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			++i;
+			continue;
+		}
+		this->upload(*pending[i]);
+		pending.erase(pending.begin() + i);
+		if (std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() >= budget)
+			break;
+	}
+}
+
+void TexManager::finishLoading()
+{
+	while (!pending.empty())
+		this->finish(pending.front());
+}
+
+std::size_t TexManager::getPendingCount() const
+{
+	return pending.size();
+}
+
+void TexManager::setUploadBudget(double budget)
+{
+	uploadBudget = budget;
+}
+
+const PixelMask::BitmapRef& TexManager::getBitmap(const std::string& id)
+{
+	PixelMask::BitmapRef& bitmap = bitmaps[id];
+	//	reading a texture back off the GPU is slow, so only ever do it once per texture
+	if (!bitmap)
+		bitmap = std::make_shared<const PixelMask::Bitmap>(get(id).copyToImage());
+	return bitmap;
+}
+
 void TexManager::setPath(const std::string& pathname)
 {
 	path = pathname;
 }
 
+/*		private		*/
+std::shared_ptr<TexManager::Pending> TexManager::findPending(const std::string& id) const
+{
+	for (const std::shared_ptr<Pending>& loading : pending)
+	{
+		if (loading->id == id)
+			return loading;
+	}
+	return nullptr;
+}
+
+void TexManager::finish(const std::shared_ptr<Pending>& loading)
+{
+	//	held on to, since erasing it from pending might otherwise free it
+	const std::shared_ptr<Pending> keep = loading;
+	keep->decoded.wait();
+	this->upload(*keep);
+	for (auto it = pending.begin(); it != pending.end(); ++it)
+	{
+		if (*it == keep)
+		{
+			pending.erase(it);
+			break;
+		}
+	}
+}
+
+void TexManager::upload(Pending& loading)
+{
+	loading.region = this->store(loading.id, loading.image, loading.pack);
+	//	the pixels are on the graphics card now
+	loading.image = sf::Image();
+	loading.ready = true;
+}
+
+TextureRegion TexManager::store(const std::string& id, const sf::Image& image, bool pack)
+{
+	const sf::Vector2u size = image.getSize();
+	//	an image that failed to load is empty, and gets an empty texture like get() would give it
+	const bool fits = size.x > 0 && size.y > 0 && size.x <= JE_ATLAS_MAX_IMAGE_SIZE && size.y <= JE_ATLAS_MAX_IMAGE_SIZE && atlas.canHold(size.x, size.y);
+	TextureRegion region;
+	if (pack && fits)
+	{
+		region = atlas.add(image);
+	}
+	else
+	{
+		sf::Texture& texture = textures[id];
+		texture.loadFromImage(image);
+		region = TextureRegion(texture);
+	}
+	if (pack)
+		regions[id] = region;
+#ifdef JE_DEBUG
+	std::cout << "Loaded " << id << (pack && fits ? " into the atlas" : "") << std::endl;
+#endif
+	return region;
+}
+
 } // je
 
 /*
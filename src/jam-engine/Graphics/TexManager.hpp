@@ -3,25 +3,173 @@
 
 #include <SFML/Graphics.hpp>
 
+#include <atomic>
+#include <future>
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
+
+#include "jam-engine/Graphics/TextureAtlas.hpp"
+#include "jam-engine/Graphics/TextureRegion.hpp"
+#include "jam-engine/Physics/PixelMask.hpp"
+
+#ifndef JE_ATLAS_MAX_IMAGE_SIZE
+	#define JE_ATLAS_MAX_IMAGE_SIZE 512
+#endif
+
+#ifndef JE_TEXTURE_UPLOAD_BUDGET
+	//	milliseconds per frame spent uploading asynchronously loaded textures
+	#define JE_TEXTURE_UPLOAD_BUDGET 2.0
+#endif
 
 namespace je
 {
 
+class Game;
+
 class TexManager
 {
+private:
+	struct Pending;
+
 public:
-	TexManager();
+	/**
+	 * What loadAsync() returns: a texture that might not have finished loading yet.
+	 * Cheap to copy, and every copy sees the same texture.
+	 */
+	class Handle
+	{
+	public:
+		Handle();
+
+		/**
+		 * @return Whether the texture has been uploaded and can be drawn with
+		 */
+		bool isReady() const;
 
+		/**
+		 * @return The texture and where on it the image is. Only valid once isReady().
+		 */
+		const TextureRegion& getRegion() const;
+
+	private:
+		friend class TexManager;
+
+		explicit Handle(std::shared_ptr<const Pending> pending);
+
+		std::shared_ptr<const Pending> pending;
+	};
+
+	/**
+	 * @param game Whose thread pool decodes asynchronously loaded images. Without one they're
+	 * decoded straight away by loadAsync().
+	 */
+	explicit TexManager(Game *game = nullptr);
+
+	/**
+	 * Gets an image as a texture of its own. The file is only ever read once: an id that's
+	 * already been packed by getRegion() or loadAsync() is copied out of its atlas page, which
+	 * means reading the page back off the graphics card, so use getRegion() for those if you can.
+	 */
 	const sf::Texture& get(const std::string& id);
 
+	/**
+	 * Gets an image packed into one of the atlas pages along with other small images, so
+	 * that they can all be drawn in the same batch. Images wider or taller than
+	 * JE_ATLAS_MAX_IMAGE_SIZE get their own texture instead (the same one get() returns).
+	 * @param id The image, which is loaded and packed the first time it's asked for
+	 * @return The page and where on it the image is
+	 */
+	const TextureRegion& getRegion(const std::string& id);
+
+	/**
+	 * Starts loading an image without waiting for it. The file is read and decoded on the
+	 * Game's worker threads, then uploadPending() puts it on the graphics card a few
+	 * textures at a time between frames. get() or getRegion() on an id that's still loading
+	 * waits for it instead of loading it again.
+	 * @param id The image, which is returned ready straight away if it's already loaded
+	 * @param pack Whether it goes in the atlas as with getRegion(), or its own texture as with get()
+	 */
+	Handle loadAsync(const std::string& id, bool pack = true);
+
+	/**
+	 * Starts loading every image in ids with loadAsync(), so they all decode in parallel
+	 */
+	void preload(const std::vector<std::string>& ids, bool pack = true);
+
+	/**
+	 * Starts loading every image listed in a manifest file, one id per line, with loadAsync()
+	 * @param filename Relative to the working directory, not the texture path
+	 * @return false if the manifest couldn't be read
+	 */
+	bool preloadManifest(const std::string& filename, bool pack = true);
+
+	/**
+	 * Uploads images that have finished decoding, in the order they were asked for, until the
+	 * budget is used up (but always at least one). Game calls this every frame.
+	 * @param budget Milliseconds to spend, or 0 for the one set by setUploadBudget()
+	 */
+	void uploadPending(double budget = 0.0);
+
+	/**
+	 * Waits for every image still loading and uploads them, for loading screens and the like
+	 */
+	void finishLoading();
+
+	/**
+	 * @return How many images are still decoding or waiting to be uploaded
+	 */
+	std::size_t getPendingCount() const;
+
+	/**
+	 * @param budget Milliseconds uploadPending() spends each frame (JE_TEXTURE_UPLOAD_BUDGET by default)
+	 */
+	void setUploadBudget(double budget);
+
+	/**
+	 * Gets the solid pixels of a texture for a PixelMask. The bitmap is made the first time
+	 * it's asked for and shared by every mask after that.
+	 * @param id The texture, which is loaded if it hasn't been yet
+	 * @return The texture's bitmap, counting any pixel that isn't fully transparent as solid
+	 */
+	const PixelMask::BitmapRef& getBitmap(const std::string& id);
+
 	void setPath(const std::string& pathname);
 
 private:
+	struct Pending
+	{
+		std::string id;
+		bool pack;
+		//!Written by the worker before decoded is made ready, then only read on the main thread
+		sf::Image image;
+		std::promise<void> decodedPromise;
+		std::shared_future<void> decoded;
+		//!Set on the main thread once uploaded
+		std::atomic<bool> ready;
+		TextureRegion region;
+	};
+
+	//!The image still loading as id, if there is one
+	std::shared_ptr<Pending> findPending(const std::string& id) const;
+
+	//!Waits for a pending image to decode, then uploads it
+	void finish(const std::shared_ptr<Pending>& pending);
+
+	void upload(Pending& pending);
+
+	//!Puts an image in the atlas or its own texture and records where
+	TextureRegion store(const std::string& id, const sf::Image& image, bool pack);
 
-    std::unordered_map<std::string, sf::Texture> textures;
+	Game *game;
+	std::unordered_map<std::string, sf::Texture> textures;
+	std::unordered_map<std::string, PixelMask::BitmapRef> bitmaps;
+	TextureAtlas atlas;
+	std::unordered_map<std::string, TextureRegion> regions;
+	//!Images still loading, oldest first
+	std::vector<std::shared_ptr<Pending>> pending;
+	double uploadBudget;
 	std::string path;
 };
 
@@ -0,0 +1,104 @@
+#include "jam-engine/Graphics/TextureAtlas.hpp"
+
+#include "jam-engine/Utility/Assert.hpp"
+
+namespace je
+{
+
+//	images start a pixel in from the edges and are a pixel apart
+static const unsigned int padding = 1;
+
+TextureAtlas::TextureAtlas(unsigned int pageSize)
+	:pages()
+	,pageSize(0)
+	,requestedPageSize(pageSize)
+{
+}
+
+TextureRegion TextureAtlas::add(const sf::Image& image)
+{
+	const unsigned int width = image.getSize().x;
+	const unsigned int height = image.getSize().y;
+	JE_ASSERT_MSG(canHold(width, height), "image too big for an atlas page");
+	unsigned int x = 0, y = 0;
+	Page *page = nullptr;
+	for (std::unique_ptr<Page>& existing : pages)
+	{
+		if (place(*existing, width, height, x, y))
+		{
+			page = existing.get();
+			break;
+		}
+	}
+	if (!page)
+	{
+		pages.emplace_back(new Page());
+		page = pages.back().get();
+		page->bottom = padding;
+		//	cleared to transparent, since a new texture's contents are undefined
+		sf::Image blank;
+		blank.create(getPageSize(), getPageSize(), sf::Color::Transparent);
+		page->texture.loadFromImage(blank);
+		place(*page, width, height, x, y);
+	}
+	page->texture.update(image, x, y);
+	return TextureRegion(page->texture, sf::IntRect(x, y, width, height));
+}
+
+bool TextureAtlas::canHold(unsigned int width, unsigned int height) const
+{
+	return width + 2 * padding <= getPageSize() && height + 2 * padding <= getPageSize();
+}
+
+std::size_t TextureAtlas::getPageCount() const
+{
+	return pages.size();
+}
+
+const sf::Texture& TextureAtlas::getPage(std::size_t index) const
+{
+	JE_ASSERT(index < pages.size());
+	return pages[index]->texture;
+}
+
+/*		private		*/
+bool TextureAtlas::place(Page& page, unsigned int width, unsigned int height, unsigned int& x, unsigned int& y) const
+{
+	const unsigned int pageSize = getPageSize();
+	//	the shortest shelf it fits on wastes the least space above it
+	Shelf *best = nullptr;
+	for (Shelf& shelf : page.shelves)
+	{
+		if (shelf.height >= height && shelf.right + width + padding <= pageSize && (!best || shelf.height < best->height))
+			best = &shelf;
+	}
+	if (!best)
+	{
+		if (page.bottom + height + padding > pageSize)
+			return false;
+		Shelf shelf;
+		shelf.top = page.bottom;
+		shelf.height = height;
+		shelf.right = padding;
+		page.shelves.push_back(shelf);
+		page.bottom += height + padding;
+		best = &page.shelves.back();
+	}
+	x = best->right;
+	y = best->top;
+	best->right += width + padding;
+	return true;
+}
+
+unsigned int TextureAtlas::getPageSize() const
+{
+	//	asking the card needs a GL context, so it waits until there are images to pack
+	if (pageSize == 0)
+	{
+		const unsigned int maximum = sf::Texture::getMaximumSize();
+		pageSize = requestedPageSize < maximum ? requestedPageSize : maximum;
+	}
+	return pageSize;
+}
+
+} // je
@@ -0,0 +1,90 @@
+#ifndef JE_TEXTURE_ATLAS_HPP
+#define JE_TEXTURE_ATLAS_HPP
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include <SFML/Graphics/Image.hpp>
+#include <SFML/Graphics/Texture.hpp>
+
+#include "jam-engine/Graphics/TextureRegion.hpp"
+
+#ifndef JE_ATLAS_PAGE_SIZE
+	#define JE_ATLAS_PAGE_SIZE 2048
+#endif
+
+namespace je
+{
+
+/**
+ * Packs images into a few large textures (pages), so that sprites from different images can be
+ * drawn with the same texture and so share a SpriteBatch run. Images go on shelves: rows as tall
+ * as the first image put on them, filled left to right, with a pixel of transparent padding
+ * around each image so that neighbours don't bleed into each other when smoothed.
+ */
+class TextureAtlas
+{
+public:
+	/**
+	 * @param pageSize The width and height of each page, capped at what the graphics card allows.
+	 * The card isn't asked until the first add() or canHold(), so an atlas can be made without a GL context.
+	 */
+	explicit TextureAtlas(unsigned int pageSize = JE_ATLAS_PAGE_SIZE);
+
+	TextureAtlas(const TextureAtlas&) = delete;
+
+	TextureAtlas& operator=(const TextureAtlas&) = delete;
+
+	/**
+	 * Copies an image into the first page with room for it, starting a new page if none have any
+	 * @param image Must fit in a page, see canHold()
+	 * @return Where the image went, which stays valid for as long as the atlas does
+	 */
+	TextureRegion add(const sf::Image& image);
+
+	/**
+	 * @return Whether an image of that size fits in a page
+	 */
+	bool canHold(unsigned int width, unsigned int height) const;
+
+	std::size_t getPageCount() const;
+
+	const sf::Texture& getPage(std::size_t index) const;
+
+private:
+	struct Shelf
+	{
+		unsigned int top;
+		unsigned int height;
+		//!How far along it's filled
+		unsigned int right;
+	};
+
+	struct Page
+	{
+		sf::Texture texture;
+		std::vector<Shelf> shelves;
+		//!Where the next shelf would start
+		unsigned int bottom;
+	};
+
+	/**
+	 * Finds room for a padded width by height rectangle in page
+	 * @return false if there's none
+	 */
+	bool place(Page& page, unsigned int width, unsigned int height, unsigned int& x, unsigned int& y) const;
+
+	//!The page size asked for, capped at sf::Texture::getMaximumSize() the first time it's needed
+	unsigned int getPageSize() const;
+
+	//!Pointers so that the textures handed out don't move
+	std::vector<std::unique_ptr<Page>> pages;
+	//!0 until getPageSize() has capped requestedPageSize
+	mutable unsigned int pageSize;
+	unsigned int requestedPageSize;
+};
+
+} // je
+
+#endif // JE_TEXTURE_ATLAS_HPP
@@ -0,0 +1,42 @@
+#ifndef JE_TEXTURE_REGION_HPP
+#define JE_TEXTURE_REGION_HPP
+
+#include <SFML/Graphics/Rect.hpp>
+#include <SFML/Graphics/Texture.hpp>
+
+namespace je
+{
+
+/**
+ * A part of a texture, such as an image packed into an atlas page by TexManager::getRegion().
+ * Doesn't own the texture.
+ */
+struct TextureRegion
+{
+	TextureRegion()
+		:texture(nullptr)
+		,rect()
+	{
+	}
+
+	//!The whole of texture
+	explicit TextureRegion(const sf::Texture& texture)
+		:texture(&texture)
+		,rect(0, 0, texture.getSize().x, texture.getSize().y)
+	{
+	}
+
+	TextureRegion(const sf::Texture& texture, const sf::IntRect& rect)
+		:texture(&texture)
+		,rect(rect)
+	{
+	}
+
+	const sf::Texture *texture;
+	//!In pixels of texture
+	sf::IntRect rect;
+};
+
+} // je
+
+#endif // JE_TEXTURE_REGION_HPP
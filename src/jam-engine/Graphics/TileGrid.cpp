@@ -2,6 +2,13 @@
 
 #include <cassert>
 #include <iostream>
+
+#include "jam-engine/Utility/Profiler.hpp"
+
+#ifndef JE_TILE_CHUNK_SIZE
+	#define JE_TILE_CHUNK_SIZE 32
+#endif
+
 namespace je
 {
 
@@ -14,6 +21,9 @@ TileGrid::TileGrid(Level * const level, int xOffset, int yOffset, int width, int
 	,cellSizeX(cellSizeX)
 	,cellSizeY(cellSizeY)
 	,bBox(xOffset, yOffset, width * cellSizeX, height * cellSizeY)
+	,chunksAcross((width + JE_TILE_CHUNK_SIZE - 1) / JE_TILE_CHUNK_SIZE)
+	,chunksHigh((height + JE_TILE_CHUNK_SIZE - 1) / JE_TILE_CHUNK_SIZE)
+	,chunks(chunksAcross * chunksHigh)
 {
 	depth = 1;	//	just so that if the user doesn't specify, at least Entities will go above it by default
 	tiles = new sf::Sprite**[width];
@@ -48,14 +58,7 @@ void TileGrid::setPos(int x, int y)
 	const int diffY = y - top;
 	if (diffX || diffY)
 	{
-		for (int i = 0; i < width; ++i)
-		{
-			for (int j = 0; j < height; ++j)
-			{
-				if (tiles[i][j])
-					tiles[i][j]->setPosition(x, y);
-			}
-		}
+		//	the chunks are relative to (left, top), so they don't need rebuilding
 		left = x;
 		top = y;
 
@@ -67,14 +70,27 @@ void TileGrid::setPos(int x, int y)
 
 void TileGrid::draw(sf::RenderTarget& target, const sf::RenderStates &states /*= sf::RenderStates::Default*/) const
 {
-	for (int i = visibleTilesByIndices.left; i < visibleTilesByIndices.width; ++i)
+	JE_PROFILE_ZONE("TileGrid::draw");
+	if (visibleTilesByIndices.width <= visibleTilesByIndices.left || visibleTilesByIndices.height <= visibleTilesByIndices.top)
+		return;
+	//	visibleTilesByIndices holds the end indices in width and height
+	const int firstChunkX = visibleTilesByIndices.left / JE_TILE_CHUNK_SIZE;
+	const int firstChunkY = visibleTilesByIndices.top / JE_TILE_CHUNK_SIZE;
+	const int lastChunkX = (visibleTilesByIndices.width - 1) / JE_TILE_CHUNK_SIZE;
+	const int lastChunkY = (visibleTilesByIndices.height - 1) / JE_TILE_CHUNK_SIZE;
+	sf::RenderStates chunkStates(states);
+	chunkStates.transform.translate(left, top);
+	for (int chunkY = firstChunkY; chunkY <= lastChunkY; ++chunkY)
 	{
-		for (int j = visibleTilesByIndices.top; j < visibleTilesByIndices.height; ++j)
+		for (int chunkX = firstChunkX; chunkX <= lastChunkX; ++chunkX)
 		{
-			if (tiles[i][j])
+			Chunk& chunk = chunks[chunkX + chunkY * chunksAcross];
+			if (chunk.dirty)
+				this->rebuildChunk(chunkX, chunkY);
+			for (const auto& layer : chunk.layers)
 			{
-				tiles[i][j]->setPosition(left + i * cellSizeX, top + j * cellSizeY);
-				target.draw(*tiles[i][j], states);
+				chunkStates.texture = layer.first;
+				target.draw(layer.second, chunkStates);
 			}
 		}
 	}
@@ -88,6 +104,7 @@ void TileGrid::setTexture(int x, int y, sf::Sprite& sprite)
 {
 	assert(x >= 0 && x < width && y >= 0 && y < height);
 	tiles[x][y] = &sprite;
+	chunks[x / JE_TILE_CHUNK_SIZE + (y / JE_TILE_CHUNK_SIZE) * chunksAcross].dirty = true;
 }
 
 void TileGrid::setVisibleArea(const sf::Rect<int>& bBox)
@@ -134,4 +151,47 @@ void TileGrid::recalculateVisibleTiles()
 	visibleTilesByPixels.height = visibleTilesByIndices.height * cellSizeY;
 }
 
+void TileGrid::rebuildChunk(int chunkX, int chunkY) const
+{
+	Chunk& chunk = chunks[chunkX + chunkY * chunksAcross];
+	for (auto& layer : chunk.layers)
+		layer.second.clear();
+	const int endX = (chunkX + 1) * JE_TILE_CHUNK_SIZE < width ? (chunkX + 1) * JE_TILE_CHUNK_SIZE : width;
+	const int endY = (chunkY + 1) * JE_TILE_CHUNK_SIZE < height ? (chunkY + 1) * JE_TILE_CHUNK_SIZE : height;
+	for (int i = chunkX * JE_TILE_CHUNK_SIZE; i < endX; ++i)
+	{
+		for (int j = chunkY * JE_TILE_CHUNK_SIZE; j < endY; ++j)
+		{
+			const sf::Sprite *tile = tiles[i][j];
+			if (!tile || !tile->getTexture())
+				continue;
+			sf::VertexArray *quads = nullptr;
+			for (auto& layer : chunk.layers)
+			{
+				if (layer.first == tile->getTexture())
+				{
+					quads = &layer.second;
+					break;
+				}
+			}
+			if (!quads)
+			{
+				chunk.layers.push_back(std::make_pair(tile->getTexture(), sf::VertexArray(sf::PrimitiveType::Quads)));
+				quads = &chunk.layers.back().second;
+			}
+			//	relative to (left, top), at the cell's corner and the size of the texture rect, as the sprites were drawn
+			const sf::IntRect& rect = tile->getTextureRect();
+			const float x = i * cellSizeX, y = j * cellSizeY;
+			const float w = rect.width < 0 ? -rect.width : rect.width;
+			const float h = rect.height < 0 ? -rect.height : rect.height;
+			const sf::Color color = tile->getColor();
+			quads->append(sf::Vertex(sf::Vector2f(x, y), color, sf::Vector2f(rect.left, rect.top)));
+			quads->append(sf::Vertex(sf::Vector2f(x + w, y), color, sf::Vector2f(rect.left + rect.width, rect.top)));
+			quads->append(sf::Vertex(sf::Vector2f(x + w, y + h), color, sf::Vector2f(rect.left + rect.width, rect.top + rect.height)));
+			quads->append(sf::Vertex(sf::Vector2f(x, y + h), color, sf::Vector2f(rect.left, rect.top + rect.height)));
+		}
+	}
+	chunk.dirty = false;
+}
+
 }
@@ -5,11 +5,19 @@
 #include <SFML/Graphics/Sprite.hpp>
 #include <SFML/Graphics/Texture.hpp>
 #include <SFML/Graphics/Rect.hpp>
+#include <SFML/Graphics/VertexArray.hpp>
+#include <utility>
+#include <vector>
 #include "jam-engine/Core/Entity.hpp"
 
 namespace je
 {
 
+/**
+ * A grid of tiles, baked into a vertex array per texture for each chunk of JE_TILE_CHUNK_SIZE
+ * by JE_TILE_CHUNK_SIZE tiles. Only the chunks in the visible area are drawn, and a chunk is only
+ * rebuilt when one of its tiles changes.
+ */
 class TileGrid : public Entity
 {
 public:
@@ -22,13 +30,33 @@ public:
 
 	void draw(sf::RenderTarget& target, const sf::RenderStates &states = sf::RenderStates::Default) const override;
 
+	/**
+	 * Sets which texture (and part of it) the tile at (x, y) uses. The sprite isn't copied, and
+	 * changes to it after this won't show until the tile is set again.
+	 */
 	void setTexture(int x, int y, sf::Sprite& sprite);
 
 	void setVisibleArea(const sf::Rect<int>& bBox);
 
 private:
+	struct Chunk
+	{
+		Chunk()
+			:layers()
+			,dirty(true)
+		{
+		}
+
+		//!One vertex array of quads per texture used in the chunk
+		std::vector<std::pair<const sf::Texture*, sf::VertexArray>> layers;
+		bool dirty;
+	};
+
 	void recalculateVisibleTiles();
 
+	//!Bakes the tiles in chunk (chunkX, chunkY) into its vertex arrays
+	void rebuildChunk(int chunkX, int chunkY) const;
+
 	sf::Sprite ***tiles;
 	int left;	   //  in pixels
 	int top;		//  in pixels
@@ -39,6 +67,10 @@ private:
 	sf::Rect<int> bBox;
 	sf::Rect<int> visibleTilesByIndices;
 	sf::Rect<int> visibleTilesByPixels;
+	int chunksAcross;
+	int chunksHigh;
+	//!Built lazily by draw(), so tiles can be set many times between frames for the cost of one rebuild
+	mutable std::vector<Chunk> chunks;
 };
 
 }
@@ -0,0 +1,191 @@
+#include "jam-engine/Pathing/FlowField.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+
+#include "jam-engine/Utility/Profiler.hpp"
+
+namespace je
+{
+
+FlowField::FlowField(PathGrid& grid)
+	:grid(grid)
+	,goals()
+	,latestGoals()
+	,costs()
+	,nexts()
+	,buildingCosts()
+	,buildingNexts()
+	,open()
+	,ready(false)
+	,building(false)
+	,stale(false)
+	,updateBudget(JE_FLOW_FIELD_BUDGET)
+{
+	grid.registerListener(this);
+}
+
+FlowField::~FlowField()
+{
+	grid.unregisterListener(this);
+}
+
+void FlowField::setGoal(const sf::Vector2f& goal)
+{
+	const sf::Vector2f goals[1] = { goal };
+	this->setGoals(goals);
+}
+
+bool FlowField::update(double budget)
+{
+	JE_PROFILE_ZONE("FlowField::update");
+	if (budget <= 0.0)
+		budget = updateBudget;
+	if (!building)
+	{
+		if (!stale)
+			return ready;
+		this->begin();
+	}
+	if (this->advance(budget))
+		this->complete();
+	return this->isUpToDate();
+}
+
+void FlowField::finish()
+{
+	//	newer goals make the field being worked out pointless when there's no hurry for one
+	if (stale)
+		this->begin();
+	else if (!building)
+		return;
+	this->advance(std::numeric_limits<double>::infinity());
+	this->complete();
+}
+
+void FlowField::setUpdateBudget(double budget)
+{
+	updateBudget = budget;
+}
+
+bool FlowField::isReady() const
+{
+	return ready;
+}
+
+bool FlowField::isUpToDate() const
+{
+	return ready && !building && !stale;
+}
+
+sf::Vector2f FlowField::getDirection(const sf::Vector2f& pos) const
+{
+	const int index = grid.getIndexFromPos(pos);
+	const int next = this->getNextIndex(index);
+	if (next == -1)
+		return sf::Vector2f(0.f, 0.f);
+	//	cells needn't be square, so the diagonals aren't always at 45 degrees
+	const sf::Vector2f step = grid.getPosFromIndex(next) - grid.getPosFromIndex(index);
+	return step / std::sqrt(step.x * step.x + step.y * step.y);
+}
+
+sf::Vector2f FlowField::getNextPos(const sf::Vector2f& pos) const
+{
+	const int index = grid.getIndexFromPos(pos);
+	const int next = this->getNextIndex(index);
+	return grid.getPosFromIndex(next == -1 ? index : next);
+}
+
+float FlowField::getCost(const sf::Vector2f& pos) const
+{
+	return this->getCost(grid.getIndexFromPos(pos));
+}
+
+void FlowField::onCellsChanged(const sf::Rect<int>& cells)
+{
+	if (stale || building || !ready)
+	{
+		stale = true;
+		return;
+	}
+	//	steps to or from cells the finished field doesn't reach, and that have no neighbour it reaches,
+	//	can't lead anywhere it does reach, so changing them leaves the field as it is
+	const int width = grid.getWidth();
+	const int left = std::max(cells.left - 1, 0);
+	const int top = std::max(cells.top - 1, 0);
+	const int right = std::min(cells.left + cells.width + 1, width);
+	const int bottom = std::min(cells.top + cells.height + 1, grid.getHeight());
+	for (int y = top; y < bottom; ++y)
+	{
+		for (int x = left; x < right; ++x)
+		{
+			if (costs[x + y * width] < std::numeric_limits<float>::infinity())
+			{
+				stale = true;
+				return;
+			}
+		}
+	}
+}
+
+/*		private		*/
+void FlowField::begin()
+{
+	const int nodeCount = grid.getNodeCount();
+	buildingCosts.assign(nodeCount, std::numeric_limits<float>::infinity());
+	buildingNexts.assign(nodeCount, -1);
+	open.clear();
+	for (int goal : goals)
+	{
+		if (buildingCosts[goal] == 0.f)
+			continue;
+		buildingCosts[goal] = 0.f;
+		open.push_back(PathHeapEntry{0.f, 0.f, goal});
+	}
+	building = true;
+	stale = false;
+}
+
+bool FlowField::advance(double budget)
+{
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	int settled = 0;
+	while (!open.empty())
+	{
+		std::pop_heap(open.begin(), open.end(), std::greater<PathHeapEntry>());
+		const PathHeapEntry entry = open.back();
+		open.pop_back();
+		//	reached more cheaply since this entry was pushed
+		if (entry.cost > buildingCosts[entry.node])
+			continue;
+		//	searching out from the goals, so it's the steps into this cell that are wanted
+		grid.forEachPredecessor(entry.node,
+			[&](int prev, float step)
+			{
+				const float newCost = entry.cost + step;
+				if (newCost >= buildingCosts[prev])
+					return;
+				buildingCosts[prev] = newCost;
+				buildingNexts[prev] = entry.node;
+				open.push_back(PathHeapEntry{newCost, newCost, prev});
+				std::push_heap(open.begin(), open.end(), std::greater<PathHeapEntry>());
+			}
+		);
+		//	reading the clock costs more than settling a cell, so it's only checked every so often
+		if (++settled % 256 == 0 && std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() >= budget)
+			return open.empty();
+	}
+	return true;
+}
+
+void FlowField::complete()
+{
+	costs.swap(buildingCosts);
+	nexts.swap(buildingNexts);
+	building = false;
+	ready = true;
+}
+
+} // je
@@ -0,0 +1,164 @@
+#ifndef JE_FLOW_FIELD_HPP
+#define JE_FLOW_FIELD_HPP
+
+#include <limits>
+#include <vector>
+
+#include <SFML/Graphics/Rect.hpp>
+#include <SFML/System/Vector2.hpp>
+
+#include "jam-engine/Pathing/PathGrid.hpp"
+#include "jam-engine/Pathing/PathSearchContext.hpp"
+
+#ifndef JE_FLOW_FIELD_BUDGET
+	//	milliseconds per update() spent working out a new flow field
+	#define JE_FLOW_FIELD_BUDGET 1.0
+#endif
+
+namespace je
+{
+
+/**
+ * For lots of agents all heading for the same goals, such as a crowd of enemies chasing the
+ * player. Rather than a search per agent, one Dijkstra search out from the goals gives every
+ * cell of the grid its cost to the nearest goal and the direction to step in to get there,
+ * so each agent just looks up the cell it's in.
+ *
+ * Working out a new field is spread over as many update() calls as it takes, and the last
+ * finished field is used until then, so a goal that moves every frame doesn't cost a whole
+ * search every frame. Agents follow the old field in the meantime, which still leads to
+ * where the goal was a few frames ago.
+ */
+class FlowField : public PathGrid::Listener
+{
+public:
+	/**
+	 * @param grid Must outlive the field
+	 */
+	explicit FlowField(PathGrid& grid);
+
+	FlowField(const FlowField&) = delete;
+
+	FlowField& operator=(const FlowField&) = delete;
+
+	~FlowField();
+
+	void setGoal(const sf::Vector2f& goal);
+
+	/**
+	 * Heads for whichever of the goals is nearest
+	 * @param goals A container of sf::Vector2f
+	 */
+	template <typename D>
+	void setGoals(const D& goals);
+
+	/**
+	 * Carries on working out the field for the latest goals, if it's out of date. Call it every frame.
+	 * A field already being worked out is finished before one for newer goals is started.
+	 * @param budget Milliseconds to spend, or 0 for the one set by setUpdateBudget()
+	 * @return Whether the field is up to date
+	 */
+	bool update(double budget = 0.0);
+
+	//!Works out the field for the latest goals now, however long it takes
+	void finish();
+
+	/**
+	 * @param budget Milliseconds update() spends (JE_FLOW_FIELD_BUDGET by default)
+	 */
+	void setUpdateBudget(double budget);
+
+	//!Whether a field has been finished yet, without which there's nothing to follow
+	bool isReady() const;
+
+	//!Whether the field is finished and for the latest goals and grid
+	bool isUpToDate() const;
+
+	/**
+	 * @return The unit vector from the centre of pos's cell towards the next cell on the cheapest
+	 * path to a goal, or (0, 0) if it's at a goal or no goal can be reached from it
+	 */
+	sf::Vector2f getDirection(const sf::Vector2f& pos) const;
+
+	/**
+	 * @return The centre of the next cell on the cheapest path to a goal, or of pos's own
+	 * cell if it's at a goal or no goal can be reached from it
+	 */
+	sf::Vector2f getNextPos(const sf::Vector2f& pos) const;
+
+	/**
+	 * @return The cost of the cheapest path from pos's cell to a goal, or infinity if there isn't one
+	 */
+	float getCost(const sf::Vector2f& pos) const;
+
+	//	the same by the cell's index, see PathGrid::getIndexFromPos()
+
+	//!The index of the next cell, or -1 at a goal or if no goal can be reached
+	inline int getNextIndex(int index) const;
+
+	inline float getCost(int index) const;
+
+	//	PathGrid::Listener
+	void onCellsChanged(const sf::Rect<int>& cells) override;
+
+private:
+	//!Starts working out a field for goals
+	void begin();
+
+	/**
+	 * Settles cells of the field being worked out until the deadline (checked every so often)
+	 * @return Whether it's finished
+	 */
+	bool advance(double budget);
+
+	//!Swaps the field that's been worked out in for the finished one
+	void complete();
+
+	PathGrid& grid;
+	//!The latest goals, as cell indices
+	std::vector<int> goals;
+	//!Scratch space for setGoals(), kept to reuse its memory
+	std::vector<int> latestGoals;
+	//!The cost from each cell to the nearest goal, and the cell to go to next, for the finished field
+	std::vector<float> costs;
+	std::vector<int> nexts;
+	//!The same for the field being worked out
+	std::vector<float> buildingCosts;
+	std::vector<int> buildingNexts;
+	//!The Dijkstra search's open list, which holds stale entries rather than updating them
+	std::vector<PathHeapEntry> open;
+	bool ready;
+	bool building;
+	//!The goals or grid changed since the field being worked out (or the finished one) was started
+	bool stale;
+	double updateBudget;
+};
+
+template <typename D>
+void FlowField::setGoals(const D& goals)
+{
+	latestGoals.clear();
+	for (const sf::Vector2f& pos : goals)
+		latestGoals.push_back(grid.getIndexFromPos(pos));
+	//	setting the same goals every frame shouldn't start a new field every frame
+	if (latestGoals != this->goals)
+	{
+		this->goals.swap(latestGoals);
+		stale = true;
+	}
+}
+
+/*			inline implementation			*/
+int FlowField::getNextIndex(int index) const
+{
+	return ready ? nexts[index] : -1;
+}
+
+float FlowField::getCost(int index) const
+{
+	return ready ? costs[index] : std::numeric_limits<float>::infinity();
+}
+
+} // je
+
+#endif // JE_FLOW_FIELD_HPP
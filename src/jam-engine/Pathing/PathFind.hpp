@@ -1,11 +1,16 @@
 #ifndef JE_PATHFIND_HPP
+#define JE_PATHFIND_HPP
 
+#include <algorithm>
+#include <cassert>
 #include <forward_list>
-#include <set>
-#include <map>
-#include <queue>
+#include <functional>
+#include <limits>
+#include <vector>
 #include <SFML/System/Vector2.hpp>
 
+#include "jam-engine/Pathing/PathSearchContext.hpp"
+
 namespace je
 {
 
@@ -46,63 +51,405 @@ void reconstructPath(std::vector<sf::Vector2f>& results, N node, const N& start,
 }
 
 
+//	for graphs whose nodes are indices, see PathGrid::getIndexFromPos()
+template <typename R, typename G>
+void reconstructIndexedPath(R& results, const G& graph, int node, int start, const PathSearchContext& context)
+{
+	do
+	{
+		results.push_front(graph.getPosFromIndex(node));
+		node = context.getPrev(node);
+	}
+	while (node != start);
+}
+
+template <typename G>
+void reconstructIndexedPath(std::vector<sf::Vector2f>& results, const G& graph, int node, int start, const PathSearchContext& context)
+{
+	const std::size_t first = results.size();
+	do
+	{
+		results.push_back(graph.getPosFromIndex(node));
+		node = context.getPrev(node);
+	}
+	while (node != start);
+	std::reverse(results.begin() + first, results.end());
+}
+
+/**
+ * Finds the cheapest path from source to the nearest of destinations with A*, using the graph's
+ * weights and heuristic. The path excludes source's node but includes the destination's,
+ * and is left empty if there's no path or source is already at a destination.
+ * The graph needs the indexed interface PathGrid has: getNodeCount(), getIndexFromPos(),
+ * getPosFromIndex(), forEachNeighbor() and estimate().
+ * @param results Where the positions of the nodes along the path are added
+ * @param destinations A container of sf::Vector2f
+ * @param context Holds the search's state, and can be reused for any number of searches
+ */
 template <typename R, typename G, typename D>
-void findSinglePath(R& results, G& graph, const sf::Vector2f& source, const D& destinations)
+void findSinglePath(R& results, const G& graph, const sf::Vector2f& source, const D& destinations, PathSearchContext& context)
 {
+	context.begin(graph.getNodeCount());
+	for (const sf::Vector2f& pos : destinations)
+		context.addDestination(graph.getIndexFromPos(pos));
+	const std::vector<int>& destIndices = context.getDestinations();
+	if (destIndices.empty())
+		return;
+	//	with several destinations, the nearest one is the only guess that can't overestimate
+	auto estimate = [&graph, &destIndices](int node) -> float
+	{
+		float best = std::numeric_limits<float>::infinity();
+		for (int dest : destIndices)
+			best = std::min(best, graph.estimate(node, dest));
+		return best;
+	};
+
+	const int start = graph.getIndexFromPos(source);
+	//	a binary heap that may hold stale entries for nodes that were since reached more cheaply,
+	//	which are skipped when popped rather than searched for and updated
+	std::vector<PathHeapEntry>& open = context.getOpen();
+	context.setCost(start, 0.f, start);
+	open.push_back(PathHeapEntry{estimate(start), 0.f, start});
+	while (!open.empty())
+	{
+		std::pop_heap(open.begin(), open.end(), std::greater<PathHeapEntry>());
+		const int node = open.back().node;
+		open.pop_back();
+		if (context.isClosed(node))
+			continue;
+		context.close(node);
+		if (context.isDestination(node))
+		{
+			if (node != start)
+				reconstructIndexedPath(results, graph, node, start, context);
+			return;
+		}
+		const float nodeCost = context.getCost(node);
+		graph.forEachNeighbor(node,
+			[&](int neighbor, float step)
+			{
+				const float newCost = nodeCost + step;
+				if (context.isClosed(neighbor) || newCost >= context.getCost(neighbor))
+					return;
+				context.setCost(neighbor, newCost, node);
+				open.push_back(PathHeapEntry{newCost + estimate(neighbor), newCost, neighbor});
+				std::push_heap(open.begin(), open.end(), std::greater<PathHeapEntry>());
+			}
+		);
+	}
 }
 
+/**
+ * As above, with PathSearchContext::forThisThread()
+ */
 template <typename R, typename G, typename D>
-void findSinglePathUnweighted(R& results, G& graph, const sf::Vector2f& source, const D& destinations)
+void findSinglePath(R& results, const G& graph, const sf::Vector2f& source, const D& destinations)
 {
-	std::map<typename G::ID, bool> visited;
-	std::map<typename G::Node, typename G::Node> prev;
-	std::queue<typename G::Node> visitQueue;
+	findSinglePath(results, graph, source, destinations, PathSearchContext::forThisThread());
+}
 
-	std::set<typename G::ID> destIDs;
+/**
+ * Finds the path from source to the nearest of destinations with the fewest steps, with a
+ * breadth-first search that ignores the graph's weights. Otherwise the same as findSinglePath().
+ */
+template <typename R, typename G, typename D>
+void findSinglePathUnweighted(R& results, const G& graph, const sf::Vector2f& source, const D& destinations, PathSearchContext& context)
+{
+	context.begin(graph.getNodeCount());
 	for (const sf::Vector2f& pos : destinations)
-		destIDs.insert(graph.getNodeFromPos(pos).getID());
+		context.addDestination(graph.getIndexFromPos(pos));
+	if (context.getDestinations().empty())
+		return;
+
+	const int start = graph.getIndexFromPos(source);
+	//	every node is queued at most once, so the queue is never popped, only read through
+	std::vector<int>& queue = context.getQueue();
+	context.setCost(start, 0.f, start);
+	queue.push_back(start);
+	for (std::size_t next = 0; next < queue.size(); ++next)
+	{
+		const int node = queue[next];
+		if (context.isDestination(node))
+		{
+			if (node != start)
+				reconstructIndexedPath(results, graph, node, start, context);
+			return;
+		}
+		const float steps = context.getCost(node) + 1.f;
+		graph.forEachNeighbor(node,
+			[&](int neighbor, float)
+			{
+				if (!context.isSeen(neighbor))
+				{
+					context.setCost(neighbor, steps, node);
+					queue.push_back(neighbor);
+				}
+			}
+		);
+	}
+}
+
+/**
+ * As above, with PathSearchContext::forThisThread()
+ */
+template <typename R, typename G, typename D>
+void findSinglePathUnweighted(R& results, const G& graph, const sf::Vector2f& source, const D& destinations)
+{
+	findSinglePathUnweighted(results, graph, source, destinations, PathSearchContext::forThisThread());
+}
+
 
-	typename G::Node start = graph.getNodeFromPos(source);
-	visited[start.getID()] = true;
-	visitQueue.push(start);
 
-	typename G::Node v = start;
+//	jump point searches only turn at jump points, so fill in the cells along each straight or diagonal leg
+template <typename R, typename G>
+void reconstructJumpPath(R& results, const G& graph, int node, int start, const PathSearchContext& context)
+{
+	const int width = graph.getWidth();
+	do
+	{
+		const int prev = context.getPrev(node);
+		const int dx = (node % width > prev % width) - (node % width < prev % width);
+		const int dy = (node / width > prev / width) - (node / width < prev / width);
+		for (int cell = node; cell != prev; cell -= dx + dy * width)
+			results.push_front(graph.getPosFromIndex(cell));
+		node = prev;
+	}
+	while (node != start);
+}
 
-	while (!visitQueue.empty())
+template <typename G>
+void reconstructJumpPath(std::vector<sf::Vector2f>& results, const G& graph, int node, int start, const PathSearchContext& context)
+{
+	const std::size_t first = results.size();
+	const int width = graph.getWidth();
+	do
 	{
-		v = visitQueue.front();
+		const int prev = context.getPrev(node);
+		const int dx = (node % width > prev % width) - (node % width < prev % width);
+		const int dy = (node / width > prev / width) - (node / width < prev / width);
+		for (int cell = node; cell != prev; cell -= dx + dy * width)
+			results.push_back(graph.getPosFromIndex(cell));
+		node = prev;
+	}
+	while (node != start);
+	std::reverse(results.begin() + first, results.end());
+}
 
-		if (destIDs.count(v.getID()))
+/**
+ * Finds the same paths as findSinglePath() with Jump Point Search, which skips over the
+ * runs of open cells that A* would otherwise add to its open list one at a time. If the grid
+ * has precomputed jump points (PathGrid::precomputeJumpPoints()) and there's one destination,
+ * the jumps are looked up rather than scanned for (JPS+).
+ * Falls back to findSinglePath() unless graph.isUniform(), or if source isn't walkable.
+ * The graph needs the interface PathGrid has.
+ */
+template <typename R, typename G, typename D>
+void findSinglePathJPS(R& results, const G& graph, const sf::Vector2f& source, const D& destinations, PathSearchContext& context)
+{
+	const int width = graph.getWidth();
+	const int height = graph.getHeight();
+	const int start = graph.getIndexFromPos(source);
+	if (!graph.isUniform() || !graph.getWalkable(start % width, start / width))
+	{
+		findSinglePath(results, graph, source, destinations, context);
+		return;
+	}
+	context.begin(graph.getNodeCount());
+	for (const sf::Vector2f& pos : destinations)
+		context.addDestination(graph.getIndexFromPos(pos));
+	const std::vector<int>& destIndices = context.getDestinations();
+	if (destIndices.empty())
+		return;
+	const bool precomputed = graph.hasJumpPoints() && destIndices.size() == 1;
+	const float diagRatio = graph.getDiagonalRatio();
+	auto estimate = [&graph, &destIndices](int node) -> float
+	{
+		float best = std::numeric_limits<float>::infinity();
+		for (int dest : destIndices)
+			best = std::min(best, graph.estimate(node, dest));
+		return best;
+	};
+	auto isOpen = [&graph, width, height](int x, int y) -> bool
+	{
+		return x >= 0 && x < width && y >= 0 && y < height && graph.getWalkable(x, y);
+	};
+	//	a straight jump stops at a destination or a cell with a forced neighbour, which is a
+	//	cell that's only reached optimally by going through it because of an obstacle beside it
+	auto jumpStraight = [&](int x, int y, int dx, int dy, int& jumpX, int& jumpY) -> bool
+	{
+		for (;;)
 		{
-			if (!prev.empty())
-				reconstructPath(results, v, start, prev);
-			break;
+			x += dx;
+			y += dy;
+			if (!isOpen(x, y))
+				return false;
+			if (context.isDestination(x + y * width)
+			 || (dx && ((!isOpen(x, y + 1) && isOpen(x + dx, y + 1)) || (!isOpen(x, y - 1) && isOpen(x + dx, y - 1))))
+			 || (dy && ((!isOpen(x + 1, y) && isOpen(x + 1, y + dy)) || (!isOpen(x - 1, y) && isOpen(x - 1, y + dy)))))
+			{
+				jumpX = x;
+				jumpY = y;
+				return true;
+			}
 		}
-
-		visitQueue.pop();
-
-		v.getNeighbors(visitQueue,
-			[&prev,&v](decltype(visitQueue)& q, typename G::Node n)
+	};
+	//	a diagonal jump also stops wherever a straight jump along either of its components would
+	auto jumpDiagonal = [&](int x, int y, int dx, int dy, int& jumpX, int& jumpY) -> bool
+	{
+		int ignoredX, ignoredY;
+		for (;;)
+		{
+			x += dx;
+			y += dy;
+			if (!isOpen(x, y))
+				return false;
+			if (context.isDestination(x + y * width)
+			 || (!isOpen(x - dx, y) && isOpen(x - dx, y + dy))
+			 || (!isOpen(x, y - dy) && isOpen(x + dx, y - dy))
+			 || jumpStraight(x, y, dx, 0, ignoredX, ignoredY)
+			 || jumpStraight(x, y, 0, dy, ignoredX, ignoredY))
 			{
-				q.push(n);
-				auto it = prev.find(n);
-				if (it == prev.end())
-					prev.insert(std::make_pair(n, v));
-				else
-					it->second = v;
-			},
-			[&visited](typename G::ID id) -> bool
+				jumpX = x;
+				jumpY = y;
+				return true;
+			}
+		}
+	};
+	//	JPS+ looks the jump up, and stops early if the destination is before it
+	const int destX = destIndices.front() % width;
+	const int destY = destIndices.front() / width;
+	auto jumpPrecomputed = [&](int x, int y, int dx, int dy, int& jumpX, int& jumpY) -> bool
+	{
+		static const int dirs[3][3] = { { 4, 2, 5 }, { 0, -1, 1 }, { 6, 3, 7 } };
+		const int distance = graph.getJumpDistance(x + y * width, dirs[dy + 1][dx + 1]);
+		const int reach = distance < 0 ? -distance : distance;
+		const int toDestX = (destX - x) * dx;
+		const int toDestY = (destY - y) * dy;
+		if (dx && dy)
+		{
+			//	the destination is ahead in both directions, so stop level with it and go straight from there
+			const int steps = toDestX < toDestY ? toDestX : toDestY;
+			if (toDestX > 0 && toDestY > 0 && steps <= reach)
 			{
-				//	optimize when you get internet and see std::map::insert's doc
-				bool ret = visited.count(id);
-				visited[id] = true;
-				return ret;
+				jumpX = x + steps * dx;
+				jumpY = y + steps * dy;
+				return true;
 			}
-		);
+		}
+		else if ((dx && destY == y && toDestX > 0 && toDestX <= reach) || (dy && destX == x && toDestY > 0 && toDestY <= reach))
+		{
+			jumpX = destX;
+			jumpY = destY;
+			return true;
+		}
+		if (distance <= 0)
+			return false;
+		jumpX = x + distance * dx;
+		jumpY = y + distance * dy;
+		return true;
+	};
+
+	std::vector<PathHeapEntry>& open = context.getOpen();
+	context.setCost(start, 0.f, start);
+	open.push_back(PathHeapEntry{estimate(start), 0.f, start});
+	while (!open.empty())
+	{
+		std::pop_heap(open.begin(), open.end(), std::greater<PathHeapEntry>());
+		const int node = open.back().node;
+		open.pop_back();
+		if (context.isClosed(node))
+			continue;
+		context.close(node);
+		if (context.isDestination(node))
+		{
+			if (node != start)
+				reconstructJumpPath(results, graph, node, start, context);
+			return;
+		}
+		const int x = node % width;
+		const int y = node / width;
+		const int prev = context.getPrev(node);
+		const int dx = (x > prev % width) - (x < prev % width);
+		const int dy = (y > prev / width) - (y < prev / width);
+
+		//	prune to the directions an optimal path through here could carry on in
+		int directions[8][2];
+		int directionCount = 0;
+		auto addDirection = [&directions, &directionCount](int dirX, int dirY)
+		{
+			directions[directionCount][0] = dirX;
+			directions[directionCount][1] = dirY;
+			++directionCount;
+		};
+		if (node == start)
+		{
+			for (int dirY = -1; dirY <= 1; ++dirY)
+				for (int dirX = -1; dirX <= 1; ++dirX)
+					if (dirX || dirY)
+						addDirection(dirX, dirY);
+		}
+		else if (dx && dy)
+		{
+			addDirection(dx, dy);
+			addDirection(dx, 0);
+			addDirection(0, dy);
+			if (!isOpen(x - dx, y) && isOpen(x - dx, y + dy))
+				addDirection(-dx, dy);
+			if (!isOpen(x, y - dy) && isOpen(x + dx, y - dy))
+				addDirection(dx, -dy);
+		}
+		else if (dx)
+		{
+			addDirection(dx, 0);
+			if (!isOpen(x, y + 1) && isOpen(x + dx, y + 1))
+				addDirection(dx, 1);
+			if (!isOpen(x, y - 1) && isOpen(x + dx, y - 1))
+				addDirection(dx, -1);
+		}
+		else
+		{
+			addDirection(0, dy);
+			if (!isOpen(x + 1, y) && isOpen(x + 1, y + dy))
+				addDirection(1, dy);
+			if (!isOpen(x - 1, y) && isOpen(x - 1, y + dy))
+				addDirection(-1, dy);
+		}
+
+		const float nodeCost = context.getCost(node);
+		for (int i = 0; i < directionCount; ++i)
+		{
+			const int dirX = directions[i][0];
+			const int dirY = directions[i][1];
+			int jumpX, jumpY;
+			bool found;
+			if (precomputed)
+				found = jumpPrecomputed(x, y, dirX, dirY, jumpX, jumpY);
+			else if (dirX && dirY)
+				found = jumpDiagonal(x, y, dirX, dirY, jumpX, jumpY);
+			else
+				found = jumpStraight(x, y, dirX, dirY, jumpX, jumpY);
+			if (!found)
+				continue;
+			const int jump = jumpX + jumpY * width;
+			const int steps = jumpX != x ? (jumpX > x ? jumpX - x : x - jumpX) : (jumpY > y ? jumpY - y : y - jumpY);
+			const float newCost = nodeCost + (dirX && dirY ? steps * diagRatio : steps);
+			if (context.isClosed(jump) || newCost >= context.getCost(jump))
+				continue;
+			context.setCost(jump, newCost, node);
+			open.push_back(PathHeapEntry{newCost + estimate(jump), newCost, jump});
+			std::push_heap(open.begin(), open.end(), std::greater<PathHeapEntry>());
+		}
 	}
 }
 
-
+/**
+ * As above, with PathSearchContext::forThisThread()
+ */
+template <typename R, typename G, typename D>
+void findSinglePathJPS(R& results, const G& graph, const sf::Vector2f& source, const D& destinations)
+{
+	findSinglePathJPS(results, graph, source, destinations, PathSearchContext::forThisThread());
+}
 }
 
 #endif
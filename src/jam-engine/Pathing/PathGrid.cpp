@@ -1,5 +1,7 @@
 #include "jam-engine/Pathing/PathGrid.hpp"
 
+#include <algorithm>
+
 namespace je
 {
 
@@ -69,6 +71,12 @@ PathGrid::PathGrid(int cellWidth, int cellHeight, int width, int height, bool al
 	,walkable(width, height)
 	,allowDiag(allowDiag)
 	,diagRatio(diagRatio)
+	,heuristic(allowDiag ? Heuristic::Octile : Heuristic::Manhattan)
+	,minWeight(1.f)
+	,weightedCells(0)
+	,regularPaths(true)
+	,jumpDistances()
+	,listeners()
 {
 	for (CellType& type : grid)
 		type = 0xFF;	//	allow all paths
@@ -78,26 +86,44 @@ PathGrid::PathGrid(int cellWidth, int cellHeight, int width, int height, bool al
 		b = true;
 }
 
+void PathGrid::registerListener(Listener *listener)
+{
+	listeners.push_back(listener);
+}
+
+void PathGrid::unregisterListener(Listener *listener)
+{
+	listeners.erase(std::remove(listeners.begin(), listeners.end(), listener), listeners.end());
+}
+
 void PathGrid::addPath(int x, int y, CellType type)
 {
 	grid.get(x, y) |= type;
+	regularPaths = false;
+	this->cellsChanged(x, y, 0);
 }
 
 void PathGrid::removePath(int x, int y, CellType type)
 {
 	grid.get(x, y) &= ~type;
+	regularPaths = false;
+	this->cellsChanged(x, y, 0);
 }
 
 void PathGrid::addAllPaths()
 {
 	for (CellType& type : grid)
 		type = 0xFF;	//	allow all paths
+	regularPaths = true;
+	this->cellsChanged(0, 0, width > height ? width : height);
 }
 
 void PathGrid::removeAllPaths()
 {
 	for (CellType& type : grid)
 		type = 0;		//	disallow all paths
+	regularPaths = false;
+	this->cellsChanged(0, 0, width > height ? width : height);
 }
 
 void PathGrid::openCell(int x, int y)
@@ -147,6 +173,7 @@ void PathGrid::openCell(int x, int y)
 			g |= canGoSE;
 		}
 	}
+	this->cellsChanged(x, y, 1);
 }
 
 void PathGrid::closeCell(int x, int y)
@@ -188,16 +215,56 @@ void PathGrid::closeCell(int x, int y)
 			grid.get(x + 1, y + 1) &= ~canGoNW;
 		}
 	}
+	this->cellsChanged(x, y, 1);
 }
 
 void PathGrid::setWalkable(int x, int y, bool val)
 {
 	walkable.get(x, y) = val;
+	//	a cell closed with closeCell() lost its paths, so opening it this way may leave them closed
+	if (val && regularPaths)
+	{
+		static const int dx[8] = { -1, 1, 0, 0, -1, 1, -1, 1 };
+		static const int dy[8] = { 0, 0, -1, 1, -1, -1, 1, 1 };
+		static const CellType dirs[8] = { canGoLeft, canGoRight, canGoUp, canGoDown, canGoNW, canGoNE, canGoSW, canGoSE };
+		//	the opposite of each direction
+		static const int back[8] = { 1, 0, 3, 2, 7, 6, 5, 4 };
+		for (int i = 0; i < 8; ++i)
+		{
+			if (isOpen(x + dx[i], y + dy[i]) && (!(grid.get(x, y) & dirs[i]) || !(grid.get(x + dx[i], y + dy[i]) & dirs[back[i]])))
+				regularPaths = false;
+		}
+	}
+	this->cellsChanged(x, y, 1);
 }
 
 void PathGrid::setWeight(int x, int y, float weight)
 {
-	weights.get(x, y) = weight;
+	assert(weight > 0.f);
+	float& old = weights.get(x, y);
+	if (old != 1.f && weight == 1.f)
+		--weightedCells;
+	else if (old == 1.f && weight != 1.f)
+		++weightedCells;
+	old = weight;
+	this->cellsChanged(x, y, 1);
+	if (weight < minWeight)
+		minWeight = weight;
+}
+
+float PathGrid::getWeight(int x, int y) const
+{
+	return weights.get(x, y);
+}
+
+void PathGrid::setHeuristic(Heuristic heuristic)
+{
+	this->heuristic = heuristic;
+}
+
+PathGrid::Heuristic PathGrid::getHeuristic() const
+{
+	return heuristic;
 }
 
 PathGrid::CellType PathGrid::getCell(int x, int y) const
@@ -225,4 +292,150 @@ PathGrid::Node PathGrid::getNodeFromPos(const sf::Vector2f& pos) const
 	return Node(*this, x, y);
 }
 
+int PathGrid::getNodeCount() const
+{
+	return width * height;
+}
+
+int PathGrid::getIndexFromPos(const sf::Vector2f& pos) const
+{
+	int x = pos.x / cellWidth;
+	if (x < 0)
+		x = 0;
+	if (x >= width)
+		x = width - 1;
+	int y = pos.y / cellHeight;
+	if (y < 0)
+		y = 0;
+	if (y >= height)
+		y = height - 1;
+	return x + y * width;
+}
+
+sf::Vector2f PathGrid::getPosFromIndex(int index) const
+{
+	return sf::Vector2f((index % width + 0.5f) * cellWidth, (index / width + 0.5f) * cellHeight);
+}
+
+float PathGrid::estimate(int from, int to) const
+{
+	int dx = from % width - to % width;
+	int dy = from / width - to / width;
+	if (dx < 0)
+		dx = -dx;
+	if (dy < 0)
+		dy = -dy;
+	switch (heuristic)
+	{
+	case Heuristic::Octile:
+	{
+		//	a diagonal step costing more than two straight ones is never worth taking
+		const float diag = diagRatio < 2.f ? diagRatio : 2.f;
+		const int straight = dx > dy ? dx - dy : dy - dx;
+		const int diagonal = dx > dy ? dy : dx;
+		return minWeight * (straight + diag * diagonal);
+	}
+	case Heuristic::Manhattan:
+		return minWeight * (dx + dy);
+	case Heuristic::None:
+	default:
+		return 0.f;
+	}
+}
+
+int PathGrid::getWidth() const
+{
+	return width;
+}
+
+int PathGrid::getHeight() const
+{
+	return height;
+}
+
+float PathGrid::getDiagonalRatio() const
+{
+	return diagRatio;
+}
+
+bool PathGrid::isUniform() const
+{
+	return allowDiag && diagRatio > 1.f && diagRatio < 2.f && weightedCells == 0 && regularPaths;
+}
+
+void PathGrid::precomputeJumpPoints()
+{
+	static const int dx[8] = { -1, 1, 0, 0, -1, 1, -1, 1 };
+	static const int dy[8] = { 0, 0, -1, 1, -1, -1, 1, 1 };
+	jumpDistances.assign(width * height * 8, 0);
+	//	the straight directions first, since the diagonals stop wherever a straight jump would find something
+	for (int dir = 0; dir < 8; ++dir)
+	{
+		const int ddx = dx[dir], ddy = dy[dir];
+		//	each cell's distance follows on from the next cell along, so work backwards from the far side
+		const int xBegin = ddx > 0 ? width - 1 : 0, xEnd = ddx > 0 ? -1 : width, xStep = ddx > 0 ? -1 : 1;
+		const int yBegin = ddy > 0 ? height - 1 : 0, yEnd = ddy > 0 ? -1 : height, yStep = ddy > 0 ? -1 : 1;
+		for (int y = yBegin; y != yEnd; y += yStep)
+		{
+			for (int x = xBegin; x != xEnd; x += xStep)
+			{
+				const int nx = x + ddx, ny = y + ddy;
+				int& distance = jumpDistances[(x + y * width) * 8 + dir];
+				if (!isOpen(nx, ny))
+				{
+					distance = 0;
+					continue;
+				}
+				bool jumpPoint;
+				if (ddx && ddy)
+				{
+					//	the forced neighbours of a diagonal step, or anything a straight jump from there would reach
+					jumpPoint = (!isOpen(nx - ddx, ny) && isOpen(nx - ddx, ny + ddy))
+					         || (!isOpen(nx, ny - ddy) && isOpen(nx + ddx, ny - ddy))
+					         || jumpDistances[(nx + ny * width) * 8 + (ddx < 0 ? 0 : 1)] > 0
+					         || jumpDistances[(nx + ny * width) * 8 + (ddy < 0 ? 2 : 3)] > 0;
+				}
+				else if (ddx)
+				{
+					jumpPoint = (!isOpen(nx, ny + 1) && isOpen(nx + ddx, ny + 1)) || (!isOpen(nx, ny - 1) && isOpen(nx + ddx, ny - 1));
+				}
+				else
+				{
+					jumpPoint = (!isOpen(nx + 1, ny) && isOpen(nx + 1, ny + ddy)) || (!isOpen(nx - 1, ny) && isOpen(nx - 1, ny + ddy));
+				}
+				const int next = jumpDistances[(nx + ny * width) * 8 + dir];
+				distance = jumpPoint ? 1 : (next > 0 ? next + 1 : next - 1);
+			}
+		}
+	}
+}
+
+bool PathGrid::hasJumpPoints() const
+{
+	return !jumpDistances.empty();
+}
+
+/*			private			*/
+bool PathGrid::isOpen(int x, int y) const
+{
+	return x >= 0 && x < width && y >= 0 && y < height && walkable.get(x, y);
+}
+
+void PathGrid::cellsChanged(int x, int y, int radius)
+{
+	jumpDistances.clear();
+	int left = x - radius, top = y - radius, right = x + radius + 1, bottom = y + radius + 1;
+	if (left < 0)
+		left = 0;
+	if (top < 0)
+		top = 0;
+	if (right > width)
+		right = width;
+	if (bottom > height)
+		bottom = height;
+	const sf::Rect<int> cells(left, top, right - left, bottom - top);
+	for (Listener *listener : listeners)
+		listener->onCellsChanged(cells);
+}
+
 }
@@ -2,6 +2,8 @@
 #define JE_PATHGRID_HPP
 
 #include <cstdint>
+#include <vector>
+#include <SFML/Graphics/Rect.hpp>
 #include <SFML/System/Vector2.hpp>
 #include "jam-engine/Utility/Grid.hpp"
 
@@ -62,8 +64,40 @@ public:
 
 	friend class PathGrid::Node;
 
+	//!What findSinglePath() guesses the remaining cost with
+	enum class Heuristic
+	{
+		//!Exact on an open grid with diagonals, the default when they're allowed
+		Octile,
+		//!Exact on an open grid without diagonals, the default otherwise. Overestimates with them, so paths found are quick but not always shortest.
+		Manhattan,
+		//!No guess, which makes the search Dijkstra's algorithm
+		None
+	};
+
+	//!Something that needs to know when the grid changes, such as a PathHierarchy
+	class Listener
+	{
+	public:
+		virtual ~Listener() {}
+
+		/**
+		 * Called after any of the cells in an area change: their walkability, weights or paths,
+		 * including paths into them from the cells around them
+		 * @param cells In cells, within the grid
+		 */
+		virtual void onCellsChanged(const sf::Rect<int>& cells) = 0;
+	};
+
 	PathGrid(int cellWidth, int cellHeight, int width, int height, bool allowDiag = true, float diagRatio = 1.4142135);
 
+	/**
+	 * @param listener Must be unregistered before it's destroyed. The grid doesn't own it.
+	 */
+	void registerListener(Listener *listener);
+
+	void unregisterListener(Listener *listener);
+
 
 	void addPath(int x, int y, CellType type);
 
@@ -93,15 +127,98 @@ public:
 	 */
 	void setWalkable(int x, int y, bool val);
 
+	/**
+	 * Sets how much it costs to step into a cell, which is multiplied by the diagonal ratio
+	 * for diagonal steps. Cells cost 1 by default.
+	 * @param weight Must be positive
+	 */
 	void setWeight(int x, int y, float weight);
 
+	float getWeight(int x, int y) const;
+
+	void setHeuristic(Heuristic heuristic);
+
+	Heuristic getHeuristic() const;
+
 	CellType getCell(int x, int y) const;
 
 	bool getWalkable(int x, int y) const;
 
 	Node getNodeFromPos(const sf::Vector2f& pos) const;
 
+	//	for searches that keep their state in arrays indexed by cell
+
+	int getNodeCount() const;
+
+	/**
+	 * @return The index of the cell pos is in, clamped to the grid like getNodeFromPos()
+	 */
+	int getIndexFromPos(const sf::Vector2f& pos) const;
+
+	//!The centre of the cell
+	sf::Vector2f getPosFromIndex(int index) const;
+
+	/**
+	 * Calls func(neighbour, cost) for every cell that can be stepped to from the one at index
+	 */
+	template <typename F>
+	void forEachNeighbor(int index, F func) const;
+
+	/**
+	 * Calls func(neighbour, cost) for every cell that can step to the one at index, which is
+	 * forEachNeighbor() backwards, for searches that start from the destination
+	 */
+	template <typename F>
+	void forEachPredecessor(int index, F func) const;
+
+	/**
+	 * @return The heuristic's guess at the cost from one cell to another, which never overestimates
+	 * (except with Heuristic::Manhattan and diagonals)
+	 */
+	float estimate(int from, int to) const;
+
+	//	for jump point search, see findSinglePathJPS()
+
+	//!In cells
+	int getWidth() const;
+
+	//!In cells
+	int getHeight() const;
+
+	float getDiagonalRatio() const;
+
+	/**
+	 * @return Whether jump point search can be used: diagonals are allowed and cost between 1 and 2,
+	 * every weight is 1, and the paths between walkable cells haven't been changed by hand
+	 * (with addPath(), removePath() or removeAllPaths()) since the last addAllPaths().
+	 */
+	bool isUniform() const;
+
+	/**
+	 * Works out how far a jump point search can jump from every cell in every direction, so that
+	 * findSinglePathJPS() can look the jumps up (JPS+) rather than scanning for them. Costs 8 ints
+	 * per cell, and is thrown away as soon as the grid changes.
+	 */
+	void precomputeJumpPoints();
+
+	bool hasJumpPoints() const;
+
+	/**
+	 * @param dir In the order forEachNeighbor() uses: left, right, up, down, NW, NE, SW, SE
+	 * @return Steps to the next jump point in that direction if positive, otherwise how many
+	 * steps can be taken before hitting something, negated. Only valid if hasJumpPoints().
+	 */
+	inline int getJumpDistance(int index, int dir) const;
+
 private:
+	//!Whether a cell is in the grid and walkable
+	bool isOpen(int x, int y) const;
+
+	/**
+	 * The cells around (x, y) changed, so any jump points are out of date and the listeners need telling
+	 * @param radius How many cells around (x, y) to tell the listeners about
+	 */
+	void cellsChanged(int x, int y, int radius);
 
 	int cellWidth, cellHeight;
 	int width, height;
@@ -110,8 +227,24 @@ private:
 	Grid<bool> walkable;
 	bool allowDiag;
 	float diagRatio;
+	Heuristic heuristic;
+	//!Never more than the lowest weight set, so that estimate() doesn't overestimate
+	float minWeight;
+	//!How many cells have a weight other than 1
+	int weightedCells;
+	//!Whether every move between walkable cells is allowed, see isUniform()
+	bool regularPaths;
+	//!8 per cell, see getJumpDistance(), or empty if they haven't been worked out
+	std::vector<int> jumpDistances;
+	std::vector<Listener*> listeners;// maintains no ownership
 };
 
+/*			inline implementation			*/
+int PathGrid::getJumpDistance(int index, int dir) const
+{
+	return jumpDistances[index * 8 + dir];
+}
+
 template <typename T, typename F, typename V>
 void PathGrid::Node::getNeighbors(T& container, F pushFunc, V visitedFunc)
 {
@@ -168,6 +301,48 @@ void PathGrid::Node::getNeighbors(T& container, F pushFunc, V visitedFunc)
 	}
 }
 
+template <typename F>
+void PathGrid::forEachNeighbor(int index, F func) const
+{
+	static const int dx[8] = { -1, 1, 0, 0, -1, 1, -1, 1 };
+	static const int dy[8] = { 0, 0, -1, 1, -1, -1, 1, 1 };
+	static const CellType dirs[8] = { canGoLeft, canGoRight, canGoUp, canGoDown, canGoNW, canGoNE, canGoSW, canGoSE };
+	const int x = index % width;
+	const int y = index / width;
+	const CellType cell = grid.get(x, y);
+	const int directions = allowDiag ? 8 : 4;
+	for (int i = 0; i < directions; ++i)
+	{
+		const int nx = x + dx[i];
+		const int ny = y + dy[i];
+		if ((cell & dirs[i]) && nx >= 0 && nx < width && ny >= 0 && ny < height && walkable.get(nx, ny))
+			func(nx + ny * width, i < 4 ? weights.get(nx, ny) : weights.get(nx, ny) * diagRatio);
+	}
+}
+
+
+template <typename F>
+void PathGrid::forEachPredecessor(int index, F func) const
+{
+	static const int dx[8] = { -1, 1, 0, 0, -1, 1, -1, 1 };
+	static const int dy[8] = { 0, 0, -1, 1, -1, -1, 1, 1 };
+	//	the way back from each of those neighbours
+	static const CellType dirs[8] = { canGoRight, canGoLeft, canGoDown, canGoUp, canGoSE, canGoSW, canGoNE, canGoNW };
+	const int x = index % width;
+	const int y = index / width;
+	if (!walkable.get(x, y))
+		return;
+	const float weight = weights.get(x, y);
+	const int directions = allowDiag ? 8 : 4;
+	for (int i = 0; i < directions; ++i)
+	{
+		const int nx = x + dx[i];
+		const int ny = y + dy[i];
+		if (nx >= 0 && nx < width && ny >= 0 && ny < height && (grid.get(nx, ny) & dirs[i]))
+			func(nx + ny * width, i < 4 ? weight : weight * diagRatio);
+	}
+}
+
 }
 
 #endif
@@ -0,0 +1,524 @@
+#include "jam-engine/Pathing/PathHierarchy.hpp"
+
+#include <algorithm>
+#include <functional>
+
+#include "jam-engine/Utility/Assert.hpp"
+
+//	runs of crossable cells along a border at least this long get an entrance at each end rather than one in the middle
+#ifndef JE_PATH_WIDE_ENTRANCE
+	#define JE_PATH_WIDE_ENTRANCE 6
+#endif
+
+namespace je
+{
+
+bool PathHierarchy::Transition::operator==(const Transition& rhs) const
+{
+	return inside == rhs.inside && outside == rhs.outside && costOut == rhs.costOut && costIn == rhs.costIn;
+}
+
+bool PathHierarchy::Edge::operator<(const Edge& rhs) const
+{
+	return from < rhs.from;
+}
+
+PathHierarchy::PathHierarchy(PathGrid& grid, int clusterSize)
+	:grid(grid)
+	,clusterSize(clusterSize)
+	,clustersAcross((grid.getWidth() + clusterSize - 1) / clusterSize)
+	,clustersHigh((grid.getHeight() + clusterSize - 1) / clusterSize)
+	,clusters(clustersAcross * clustersHigh)
+	,anyDirty(true)
+	,abstractContext()
+	,clusterContext()
+	,queryEdges()
+	,destCells()
+	,abstractPath()
+	,path()
+	,leg()
+{
+	JE_ASSERT(clusterSize > 0);
+	for (int i = 0; i < getClusterCount(); ++i)
+	{
+		Cluster& cluster = clusters[i];
+		const int left = (i % clustersAcross) * clusterSize;
+		const int top = (i / clustersAcross) * clusterSize;
+		cluster.bounds = sf::Rect<int>(left, top, std::min(clusterSize, grid.getWidth() - left), std::min(clusterSize, grid.getHeight() - top));
+		//	everything gets built by the first update()
+		cluster.dirty = true;
+		cluster.edgesDirty = true;
+	}
+	grid.registerListener(this);
+}
+
+PathHierarchy::~PathHierarchy()
+{
+	grid.unregisterListener(this);
+}
+
+void PathHierarchy::update()
+{
+	if (!anyDirty)
+		return;
+	for (int i = 0; i < getClusterCount(); ++i)
+	{
+		Cluster& cluster = clusters[i];
+		if (!cluster.dirty)
+			continue;
+		//	the neighbours only need their edges rebuilding if the entrances they share changed
+		if (this->buildBorder(i, true))
+			clusters[i + 1].edgesDirty = true;
+		if (this->buildBorder(i, false))
+			clusters[i + clustersAcross].edgesDirty = true;
+		if (i % clustersAcross > 0 && this->buildBorder(i - 1, true))
+			clusters[i - 1].edgesDirty = true;
+		if (i >= clustersAcross && this->buildBorder(i - clustersAcross, false))
+			clusters[i - clustersAcross].edgesDirty = true;
+		//	whether a corner needs a transition depends on all four cells around it, so this
+		//	cluster's cells can change the corners of any cluster touching it from above or beside
+		const int x = i % clustersAcross;
+		const int y = i / clustersAcross;
+		for (int cornerY = std::max(y - 1, 0); cornerY <= y; ++cornerY)
+		{
+			for (int cornerX = std::max(x - 1, 0); cornerX <= std::min(x + 1, clustersAcross - 1); ++cornerX)
+			{
+				const int owner = cornerX + cornerY * clustersAcross;
+				const std::pair<bool, bool> changed = this->buildCorners(owner);
+				if (changed.first)
+				{
+					clusters[owner].edgesDirty = true;
+					clusters[owner + clustersAcross + 1].edgesDirty = true;
+				}
+				if (changed.second)
+				{
+					clusters[owner].edgesDirty = true;
+					clusters[owner + clustersAcross - 1].edgesDirty = true;
+				}
+			}
+		}
+		cluster.edgesDirty = true;
+		cluster.dirty = false;
+	}
+	for (int i = 0; i < getClusterCount(); ++i)
+	{
+		if (clusters[i].edgesDirty)
+			this->buildEdges(i);
+	}
+	anyDirty = false;
+}
+
+int PathHierarchy::getClusterCount() const
+{
+	return clustersAcross * clustersHigh;
+}
+
+std::size_t PathHierarchy::getEntranceCount() const
+{
+	std::size_t count = 0;
+	for (const Cluster& cluster : clusters)
+		count += cluster.nodes.size();
+	return count;
+}
+
+void PathHierarchy::onCellsChanged(const sf::Rect<int>& cells)
+{
+	if (cells.width <= 0 || cells.height <= 0)
+		return;
+	const int lastX = (cells.left + cells.width - 1) / clusterSize;
+	const int lastY = (cells.top + cells.height - 1) / clusterSize;
+	for (int y = cells.top / clusterSize; y <= lastY; ++y)
+		for (int x = cells.left / clusterSize; x <= lastX; ++x)
+			clusters[x + y * clustersAcross].dirty = true;
+	anyDirty = true;
+}
+
+/*		private		*/
+void PathHierarchy::appendPath(std::vector<sf::Vector2f>& results) const
+{
+	for (int cell : path)
+		results.push_back(grid.getPosFromIndex(cell));
+}
+
+void PathHierarchy::findCells(int start)
+{
+	path.clear();
+	this->update();
+	if (destCells.empty())
+		return;
+
+	//	paths that only go a cluster or so are where detouring through the entrances costs the most,
+	//	and a search of the clusters around the start is cheap anyway
+	const int width = grid.getWidth();
+	const int startCluster = this->clusterOf(start);
+	const int nearLeft = std::max(startCluster % clustersAcross - 1, 0) * clusterSize;
+	const int nearTop = std::max(startCluster / clustersAcross - 1, 0) * clusterSize;
+	const sf::Rect<int> nearby(nearLeft, nearTop, std::min(nearLeft + 3 * clusterSize, grid.getWidth()) - nearLeft, std::min(nearTop + 3 * clusterSize, grid.getHeight()) - nearTop);
+	bool allNearby = true;
+	for (int dest : destCells)
+		allNearby = allNearby && nearby.contains(dest % width, dest / width);
+	if (allNearby)
+	{
+		const int reached = this->searchArea(start, destCells.data(), destCells.size(), nearby);
+		if (reached != -1)
+		{
+			this->appendLeg(start, reached);
+			return;
+		}
+	}
+
+	//	join the start and destinations to the abstract graph for just this search
+	queryEdges.clear();
+	const Cluster& first = clusters[startCluster];
+	this->searchArea(start, nullptr, 0, first.bounds);
+	for (int node : first.nodes)
+	{
+		const float cost = clusterContext.getCost(node);
+		if (node != start && cost < std::numeric_limits<float>::infinity())
+			queryEdges.push_back(Edge{start, node, cost});
+	}
+	for (int dest : destCells)
+	{
+		const float cost = clusterContext.getCost(dest);
+		if (dest != start && this->clusterOf(dest) == startCluster && cost < std::numeric_limits<float>::infinity())
+			queryEdges.push_back(Edge{start, dest, cost});
+	}
+	for (int dest : destCells)
+	{
+		const Cluster& last = clusters[this->clusterOf(dest)];
+		for (int node : last.nodes)
+		{
+			if (node == dest)
+				continue;
+			this->searchArea(node, &dest, 1, last.bounds);
+			const float cost = clusterContext.getCost(dest);
+			if (cost < std::numeric_limits<float>::infinity())
+				queryEdges.push_back(Edge{node, dest, cost});
+		}
+	}
+
+	//	A* over the entrances, the same as findSinglePath() but with far fewer nodes
+	abstractContext.begin(grid.getNodeCount());
+	for (int dest : destCells)
+		abstractContext.addDestination(dest);
+	auto estimate = [this](int node) -> float
+	{
+		float best = std::numeric_limits<float>::infinity();
+		for (int dest : destCells)
+			best = std::min(best, grid.estimate(node, dest));
+		return best;
+	};
+	std::vector<PathHeapEntry>& open = abstractContext.getOpen();
+	abstractContext.setCost(start, 0.f, start);
+	open.push_back(PathHeapEntry{estimate(start), 0.f, start});
+	int found = -1;
+	while (!open.empty())
+	{
+		std::pop_heap(open.begin(), open.end(), std::greater<PathHeapEntry>());
+		const int node = open.back().node;
+		open.pop_back();
+		if (abstractContext.isClosed(node))
+			continue;
+		abstractContext.close(node);
+		if (abstractContext.isDestination(node))
+		{
+			found = node;
+			break;
+		}
+		const float nodeCost = abstractContext.getCost(node);
+		this->forEachAbstractNeighbor(node,
+			[&](int neighbor, float step)
+			{
+				const float newCost = nodeCost + step;
+				if (abstractContext.isClosed(neighbor) || newCost >= abstractContext.getCost(neighbor))
+					return;
+				abstractContext.setCost(neighbor, newCost, node);
+				open.push_back(PathHeapEntry{newCost + estimate(neighbor), newCost, neighbor});
+				std::push_heap(open.begin(), open.end(), std::greater<PathHeapEntry>());
+			}
+		);
+	}
+	if (found == -1 || found == start)
+		return;
+
+	abstractPath.clear();
+	for (int node = found; node != start; node = abstractContext.getPrev(node))
+		abstractPath.push_back(node);
+	abstractPath.push_back(start);
+	std::reverse(abstractPath.begin(), abstractPath.end());
+
+	//	then refine it: steps between clusters are already single cells, so only the legs inside one need searching
+	for (std::size_t i = 1; i < abstractPath.size(); ++i)
+	{
+		const int from = abstractPath[i - 1];
+		const int to = abstractPath[i];
+		const int cluster = this->clusterOf(from);
+		if (cluster != this->clusterOf(to))
+		{
+			path.push_back(to);
+			continue;
+		}
+		const int reached = this->searchArea(from, &to, 1, clusters[cluster].bounds);
+		JE_ASSERT_MSG(reached == to, "abstract edge with no path behind it");
+		this->appendLeg(from, to);
+	}
+}
+
+void PathHierarchy::appendLeg(int from, int to)
+{
+	leg.clear();
+	for (int cell = to; cell != from; cell = clusterContext.getPrev(cell))
+		leg.push_back(cell);
+	path.insert(path.end(), leg.rbegin(), leg.rend());
+}
+
+bool PathHierarchy::buildBorder(int cluster, bool east)
+{
+	Cluster& c = clusters[cluster];
+	std::vector<Transition>& transitions = east ? c.east : c.south;
+	const bool edge = east ? cluster % clustersAcross == clustersAcross - 1 : cluster / clustersAcross == clustersHigh - 1;
+	if (edge)
+		return false;
+	const std::vector<Transition> old = std::move(transitions);
+	transitions.clear();
+	const int width = grid.getWidth();
+	//	walks along the cells just inside the border, with the ones just outside it a step away
+	const int length = east ? c.bounds.height : c.bounds.width;
+	const int firstInside = east ? (c.bounds.left + c.bounds.width - 1) + c.bounds.top * width : c.bounds.left + (c.bounds.top + c.bounds.height - 1) * width;
+	const int along = east ? width : 1;
+	const int across = east ? 1 : width;
+	//	1 if the border can be crossed out of the cluster there, 2 if into it, 3 if both.
+	//	Runs are split wherever this changes, so that the cell a run's entrance goes on can
+	//	always be crossed the same ways as every other cell in the run
+	auto crosses = [&](int i) -> int
+	{
+		const int inside = firstInside + i * along;
+		return (this->stepCost(inside, inside + across) < std::numeric_limits<float>::infinity() ? 1 : 0)
+		     | (this->stepCost(inside + across, inside) < std::numeric_limits<float>::infinity() ? 2 : 0);
+	};
+	auto addTransition = [&](int inside, int outside)
+	{
+		transitions.push_back(Transition{inside, outside, this->stepCost(inside, outside), this->stepCost(outside, inside)});
+	};
+	int runStart = -1;
+	int runCrosses = 0;
+	for (int i = 0; i <= length; ++i)
+	{
+		const int crossing = i < length ? crosses(i) : 0;
+		const bool open = crossing != 0;
+		if (runStart != -1 && crossing != runCrosses)
+		{
+			const int runEnd = i - 1;
+			if (runEnd - runStart + 1 < JE_PATH_WIDE_ENTRANCE)
+			{
+				const int middle = firstInside + ((runStart + runEnd) / 2) * along;
+				addTransition(middle, middle + across);
+			}
+			else
+			{
+				addTransition(firstInside + runStart * along, firstInside + runStart * along + across);
+				addTransition(firstInside + runEnd * along, firstInside + runEnd * along + across);
+			}
+			runStart = -1;
+		}
+		if (open && runStart == -1)
+		{
+			runStart = i;
+			runCrosses = crossing;
+		}
+		//	a gap only crossable diagonally, such as between two walls that meet at a corner
+		if (i + 1 < length && !open && !crosses(i + 1))
+		{
+			const int inside = firstInside + i * along;
+			const int next = inside + along;
+			if (this->stepCost(inside, next + across) < std::numeric_limits<float>::infinity()
+			 || this->stepCost(next + across, inside) < std::numeric_limits<float>::infinity())
+				addTransition(inside, next + across);
+			if (this->stepCost(next, inside + across) < std::numeric_limits<float>::infinity()
+			 || this->stepCost(inside + across, next) < std::numeric_limits<float>::infinity())
+				addTransition(next, inside + across);
+		}
+	}
+	return transitions != old;
+}
+
+std::pair<bool, bool> PathHierarchy::buildCorners(int cluster)
+{
+	Cluster& c = clusters[cluster];
+	const std::vector<Transition> oldSouthEast = std::move(c.southEast);
+	const std::vector<Transition> oldSouthWest = std::move(c.southWest);
+	c.southEast.clear();
+	c.southWest.clear();
+	const int x = cluster % clustersAcross;
+	if (cluster / clustersAcross < clustersHigh - 1)
+	{
+		const int width = grid.getWidth();
+		const float infinity = std::numeric_limits<float>::infinity();
+		auto joined = [this, infinity](int a, int b) -> bool
+		{
+			return this->stepCost(a, b) < infinity || this->stepCost(b, a) < infinity;
+		};
+		//	only needed when the step can't also be made by going around the corner through one
+		//	of the other two clusters, which the borders already have entrances for
+		auto addCorner = [&](std::vector<Transition>& corner, int inside, int outside, int beside, int below)
+		{
+			if (joined(inside, outside) && !(joined(inside, beside) && joined(beside, outside)) && !(joined(inside, below) && joined(below, outside)))
+				corner.push_back(Transition{inside, outside, this->stepCost(inside, outside), this->stepCost(outside, inside)});
+		};
+		const int bottom = (c.bounds.top + c.bounds.height - 1) * width;
+		if (x < clustersAcross - 1)
+		{
+			const int inside = bottom + c.bounds.left + c.bounds.width - 1;
+			addCorner(c.southEast, inside, inside + width + 1, inside + 1, inside + width);
+		}
+		if (x > 0)
+		{
+			const int inside = bottom + c.bounds.left;
+			addCorner(c.southWest, inside, inside + width - 1, inside - 1, inside + width);
+		}
+	}
+	return std::make_pair(c.southEast != oldSouthEast, c.southWest != oldSouthWest);
+}
+
+void PathHierarchy::buildEdges(int cluster)
+{
+	Cluster& c = clusters[cluster];
+	//	the clusters diagonally above, whose bottom corners touch this one's top ones
+	const int x = cluster % clustersAcross;
+	const int northWest = cluster >= clustersAcross && x > 0 ? cluster - clustersAcross - 1 : -1;
+	const int northEast = cluster >= clustersAcross && x < clustersAcross - 1 ? cluster - clustersAcross + 1 : -1;
+	c.nodes.clear();
+	for (const Transition& t : c.east)
+		c.nodes.push_back(t.inside);
+	for (const Transition& t : c.south)
+		c.nodes.push_back(t.inside);
+	for (const Transition& t : c.southEast)
+		c.nodes.push_back(t.inside);
+	for (const Transition& t : c.southWest)
+		c.nodes.push_back(t.inside);
+	if (cluster % clustersAcross > 0)
+		for (const Transition& t : clusters[cluster - 1].east)
+			c.nodes.push_back(t.outside);
+	if (cluster >= clustersAcross)
+		for (const Transition& t : clusters[cluster - clustersAcross].south)
+			c.nodes.push_back(t.outside);
+	if (northWest != -1)
+		for (const Transition& t : clusters[northWest].southEast)
+			c.nodes.push_back(t.outside);
+	if (northEast != -1)
+		for (const Transition& t : clusters[northEast].southWest)
+			c.nodes.push_back(t.outside);
+	std::sort(c.nodes.begin(), c.nodes.end());
+	c.nodes.erase(std::unique(c.nodes.begin(), c.nodes.end()), c.nodes.end());
+
+	const std::size_t count = c.nodes.size();
+	c.costs.resize(count * count);
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		this->searchArea(c.nodes[i], nullptr, 0, c.bounds);
+		for (std::size_t j = 0; j < count; ++j)
+			c.costs[i * count + j] = clusterContext.getCost(c.nodes[j]);
+	}
+
+	c.exits.clear();
+	auto addExit = [&c](int from, int to, float cost)
+	{
+		if (cost < std::numeric_limits<float>::infinity())
+			c.exits.push_back(Edge{from, to, cost});
+	};
+	for (const Transition& t : c.east)
+		addExit(t.inside, t.outside, t.costOut);
+	for (const Transition& t : c.south)
+		addExit(t.inside, t.outside, t.costOut);
+	for (const Transition& t : c.southEast)
+		addExit(t.inside, t.outside, t.costOut);
+	for (const Transition& t : c.southWest)
+		addExit(t.inside, t.outside, t.costOut);
+	if (cluster % clustersAcross > 0)
+		for (const Transition& t : clusters[cluster - 1].east)
+			addExit(t.outside, t.inside, t.costIn);
+	if (cluster >= clustersAcross)
+		for (const Transition& t : clusters[cluster - clustersAcross].south)
+			addExit(t.outside, t.inside, t.costIn);
+	if (northWest != -1)
+		for (const Transition& t : clusters[northWest].southEast)
+			addExit(t.outside, t.inside, t.costIn);
+	if (northEast != -1)
+		for (const Transition& t : clusters[northEast].southWest)
+			addExit(t.outside, t.inside, t.costIn);
+	std::sort(c.exits.begin(), c.exits.end());
+	c.firstExit.resize(count + 1);
+	for (std::size_t i = 0; i < count; ++i)
+		c.firstExit[i] = std::lower_bound(c.exits.begin(), c.exits.end(), Edge{c.nodes[i], 0, 0.f}) - c.exits.begin();
+	c.firstExit[count] = c.exits.size();
+	c.edgesDirty = false;
+}
+
+int PathHierarchy::clusterOf(int cell) const
+{
+	const int width = grid.getWidth();
+	return (cell % width) / clusterSize + ((cell / width) / clusterSize) * clustersAcross;
+}
+
+float PathHierarchy::stepCost(int from, int to) const
+{
+	float cost = std::numeric_limits<float>::infinity();
+	//	setWalkable() leaves a cell's paths alone, so forEachNeighbor() would still step out of it
+	const int width = grid.getWidth();
+	if (!grid.getWalkable(from % width, from / width))
+		return cost;
+	grid.forEachNeighbor(from,
+		[to, &cost](int neighbor, float step)
+		{
+			if (neighbor == to)
+				cost = step;
+		}
+	);
+	return cost;
+}
+
+int PathHierarchy::searchArea(int from, const int *targets, std::size_t targetCount, const sf::Rect<int>& area)
+{
+	clusterContext.begin(grid.getNodeCount());
+	for (std::size_t i = 0; i < targetCount; ++i)
+		clusterContext.addDestination(targets[i]);
+	auto estimate = [this, targets, targetCount](int node) -> float
+	{
+		float best = targetCount ? std::numeric_limits<float>::infinity() : 0.f;
+		for (std::size_t i = 0; i < targetCount; ++i)
+			best = std::min(best, grid.estimate(node, targets[i]));
+		return best;
+	};
+	const int width = grid.getWidth();
+	std::vector<PathHeapEntry>& open = clusterContext.getOpen();
+	clusterContext.setCost(from, 0.f, from);
+	open.push_back(PathHeapEntry{estimate(from), 0.f, from});
+	while (!open.empty())
+	{
+		std::pop_heap(open.begin(), open.end(), std::greater<PathHeapEntry>());
+		const int node = open.back().node;
+		open.pop_back();
+		if (clusterContext.isClosed(node))
+			continue;
+		clusterContext.close(node);
+		if (clusterContext.isDestination(node))
+			return node;
+		const float nodeCost = clusterContext.getCost(node);
+		grid.forEachNeighbor(node,
+			[&](int neighbor, float step)
+			{
+				if (!area.contains(neighbor % width, neighbor / width))
+					return;
+				const float newCost = nodeCost + step;
+				if (clusterContext.isClosed(neighbor) || newCost >= clusterContext.getCost(neighbor))
+					return;
+				clusterContext.setCost(neighbor, newCost, node);
+				open.push_back(PathHeapEntry{newCost + estimate(neighbor), newCost, neighbor});
+				std::push_heap(open.begin(), open.end(), std::greater<PathHeapEntry>());
+			}
+		);
+	}
+	return -1;
+}
+
+} // je
@@ -0,0 +1,215 @@
+#ifndef JE_PATH_HIERARCHY_HPP
+#define JE_PATH_HIERARCHY_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include <SFML/Graphics/Rect.hpp>
+#include <SFML/System/Vector2.hpp>
+
+#include "jam-engine/Pathing/PathGrid.hpp"
+#include "jam-engine/Pathing/PathSearchContext.hpp"
+
+#ifndef JE_PATH_CLUSTER_SIZE
+	#define JE_PATH_CLUSTER_SIZE 16
+#endif
+
+namespace je
+{
+
+/**
+ * Hierarchical pathfinding (HPA*) over a PathGrid. The grid is split into square clusters, and
+ * the cells where paths can cross from one cluster to the next (entrances) become the nodes of a
+ * much smaller graph, joined by the costs of the paths between them inside each cluster. Long
+ * paths are found on that graph, and only the legs of the path found are then searched cell by cell.
+ * Paths are close to, but not always, the cheapest.
+ *
+ * Listens to the grid, and rebuilds only the clusters around cells that change.
+ */
+class PathHierarchy : public PathGrid::Listener
+{
+public:
+	/**
+	 * @param grid Must outlive the hierarchy
+	 * @param clusterSize The width and height of the clusters in cells
+	 */
+	PathHierarchy(PathGrid& grid, int clusterSize = JE_PATH_CLUSTER_SIZE);
+
+	PathHierarchy(const PathHierarchy&) = delete;
+
+	PathHierarchy& operator=(const PathHierarchy&) = delete;
+
+	~PathHierarchy();
+
+	/**
+	 * Finds a path like findSinglePath() does, calling update() first
+	 * @param results Where the positions of the cells along the path are added
+	 * @param destinations A container of sf::Vector2f
+	 */
+	template <typename R, typename D>
+	void findPath(R& results, const sf::Vector2f& source, const D& destinations);
+
+	/**
+	 * Rebuilds the clusters whose cells have changed since the last update. Done by findPath(),
+	 * but can be called sooner to keep the cost away from the first search after a change.
+	 */
+	void update();
+
+	int getClusterCount() const;
+
+	/**
+	 * @return How many entrance nodes the abstract graph has, counting both sides of each
+	 */
+	std::size_t getEntranceCount() const;
+
+	//	PathGrid::Listener
+	void onCellsChanged(const sf::Rect<int>& cells) override;
+
+private:
+	//!A pair of cells either side of the border between two clusters
+	struct Transition
+	{
+		int inside;
+		int outside;
+		//!Infinite if the step can't be taken
+		float costOut;
+		float costIn;
+
+		bool operator==(const Transition& rhs) const;
+	};
+
+	//!A step or path from one cell to another
+	struct Edge
+	{
+		int from;
+		int to;
+		float cost;
+
+		bool operator<(const Edge& rhs) const;
+	};
+
+	struct Cluster
+	{
+		sf::Rect<int> bounds;
+		//!With the clusters to the east and south, the ones to the west and north hold the other borders
+		std::vector<Transition> east;
+		std::vector<Transition> south;
+		//!The diagonal steps across the bottom corners to the clusters south-east and south-west, at most one each
+		std::vector<Transition> southEast;
+		std::vector<Transition> southWest;
+		//!The cells on this side of every transition on any of the four borders or corners, sorted
+		std::vector<int> nodes;
+		//!Between each pair of nodes inside the cluster, nodes.size() squared of them
+		std::vector<float> costs;
+		//!The steps out of the cluster from its nodes, sorted by the node they're from
+		std::vector<Edge> exits;
+		//!Where each node's exits start, with one more at the end
+		std::vector<int> firstExit;
+		//!Its cells changed, so its borders need rebuilding
+		bool dirty;
+		//!Its nodes or the paths between them might have changed
+		bool edgesDirty;
+	};
+
+	//!Fills path with the cells from start to the nearest of destCells, not including start
+	void findCells(int start);
+
+	/**
+	 * Rebuilds the transitions on a cluster's east or south border
+	 * @return Whether they changed
+	 */
+	bool buildBorder(int cluster, bool east);
+
+	/**
+	 * Rebuilds the transitions across a cluster's bottom two corners
+	 * @return Whether the south-east one changed, and whether the south-west one did
+	 */
+	std::pair<bool, bool> buildCorners(int cluster);
+
+	void buildEdges(int cluster);
+
+	int clusterOf(int cell) const;
+
+	//!Infinite if there's no step from one to the other
+	float stepCost(int from, int to) const;
+
+	/**
+	 * Searches from one cell to the nearest of targets without leaving area, leaving the costs and
+	 * paths in clusterContext
+	 * @param targetCount 0 to reach everything in area with Dijkstra's algorithm
+	 * @return The target reached, or -1 if none were
+	 */
+	int searchArea(int from, const int *targets, std::size_t targetCount, const sf::Rect<int>& area);
+
+	//!Adds the cells searchArea() went through to path, after from up to and including to
+	void appendLeg(int from, int to);
+
+	template <typename F>
+	void forEachAbstractNeighbor(int node, F func) const;
+
+	template <typename R>
+	void appendPath(R& results) const;
+
+	void appendPath(std::vector<sf::Vector2f>& results) const;
+
+	PathGrid& grid;
+	int clusterSize;
+	int clustersAcross;
+	int clustersHigh;
+	std::vector<Cluster> clusters;
+	bool anyDirty;
+	PathSearchContext abstractContext;
+	PathSearchContext clusterContext;
+	//	scratch space for findCells(), kept to reuse its memory
+	//!Edges to or from cells that aren't nodes, added just for one search
+	std::vector<Edge> queryEdges;
+	std::vector<int> destCells;
+	std::vector<int> abstractPath;
+	std::vector<int> path;
+	std::vector<int> leg;
+};
+
+template <typename R, typename D>
+void PathHierarchy::findPath(R& results, const sf::Vector2f& source, const D& destinations)
+{
+	destCells.clear();
+	for (const sf::Vector2f& pos : destinations)
+		destCells.push_back(grid.getIndexFromPos(pos));
+	this->findCells(grid.getIndexFromPos(source));
+	this->appendPath(results);
+}
+
+template <typename F>
+void PathHierarchy::forEachAbstractNeighbor(int node, F func) const
+{
+	const Cluster& c = clusters[this->clusterOf(node)];
+	auto it = std::lower_bound(c.nodes.begin(), c.nodes.end(), node);
+	if (it != c.nodes.end() && *it == node)
+	{
+		const std::size_t count = c.nodes.size();
+		const std::size_t i = it - c.nodes.begin();
+		const float *costs = &c.costs[i * count];
+		for (std::size_t j = 0; j < count; ++j)
+			if (j != i && costs[j] < std::numeric_limits<float>::infinity())
+				func(c.nodes[j], costs[j]);
+		for (int exit = c.firstExit[i]; exit < c.firstExit[i + 1]; ++exit)
+			func(c.exits[exit].to, c.exits[exit].cost);
+	}
+	for (const Edge& edge : queryEdges)
+		if (edge.from == node)
+			func(edge.to, edge.cost);
+}
+
+template <typename R>
+void PathHierarchy::appendPath(R& results) const
+{
+	for (auto it = path.rbegin(); it != path.rend(); ++it)
+		results.push_front(grid.getPosFromIndex(*it));
+}
+
+} // je
+
+#endif // JE_PATH_HIERARCHY_HPP
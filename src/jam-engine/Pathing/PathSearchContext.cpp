@@ -0,0 +1,47 @@
+#include "jam-engine/Pathing/PathSearchContext.hpp"
+
+#include <algorithm>
+
+namespace je
+{
+
+PathSearchContext::PathSearchContext()
+	:stamps()
+	,flags()
+	,costs()
+	,prevs()
+	,destinations()
+	,open()
+	,queue()
+	,generation(0)
+{
+}
+
+void PathSearchContext::begin(int nodeCount)
+{
+	if (stamps.size() < static_cast<std::size_t>(nodeCount))
+	{
+		//	new nodes are stamped 0, which is never a current generation
+		stamps.resize(nodeCount, 0);
+		flags.resize(nodeCount);
+		costs.resize(nodeCount);
+		prevs.resize(nodeCount);
+	}
+	if (++generation == 0)
+	{
+		//	after 4 billion searches the stamps wrap around, and the old ones could be mistaken for new ones
+		std::fill(stamps.begin(), stamps.end(), 0);
+		generation = 1;
+	}
+	destinations.clear();
+	open.clear();
+	queue.clear();
+}
+
+PathSearchContext& PathSearchContext::forThisThread()
+{
+	static thread_local PathSearchContext context;
+	return context;
+}
+
+} // je
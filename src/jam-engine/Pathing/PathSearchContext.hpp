@@ -0,0 +1,182 @@
+#ifndef JE_PATH_SEARCH_CONTEXT_HPP
+#define JE_PATH_SEARCH_CONTEXT_HPP
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace je
+{
+
+//!An entry in a search's open list
+struct PathHeapEntry
+{
+	//!Cost so far plus the estimate
+	float priority;
+	//!Cost so far, to break ties towards nodes closer to a destination
+	float cost;
+	int node;
+
+	bool operator>(const PathHeapEntry& rhs) const
+	{
+		return priority > rhs.priority || (priority == rhs.priority && cost < rhs.cost);
+	}
+};
+
+/**
+ * The per-node state of a search over an indexed graph (such as a PathGrid), kept in flat arrays
+ * that are reused from one search to the next. Each node is stamped with the search that last
+ * touched it, so starting a new search doesn't need to clear anything, and once the arrays have
+ * grown to the graph's size searches don't allocate at all.
+ * A context can only be used by one search at a time.
+ */
+class PathSearchContext
+{
+public:
+	PathSearchContext();
+
+	/**
+	 * Starts a new search, which forgets everything about the last one
+	 * @param nodeCount How many nodes the graph has
+	 */
+	void begin(int nodeCount);
+
+	/**
+	 * @return A context for the calling thread, which is what searches use when they aren't given one
+	 */
+	static PathSearchContext& forThisThread();
+
+	//!Whether node has been reached (given a cost) in this search
+	inline bool isSeen(int node) const;
+
+	//!Whether node's cheapest cost is known in this search
+	inline bool isClosed(int node) const;
+
+	inline bool isDestination(int node) const;
+
+	//!The cheapest cost found so far to node, or infinity if it hasn't been reached
+	inline float getCost(int node) const;
+
+	//!The node node was reached from. Only valid for nodes that have been seen.
+	inline int getPrev(int node) const;
+
+	//!Records a cheaper way to reach node
+	inline void setCost(int node, float cost, int prev);
+
+	inline void close(int node);
+
+	/**
+	 * Marks node as a destination
+	 * @return false if it already was
+	 */
+	inline bool addDestination(int node);
+
+	//!Every node added with addDestination() this search
+	inline const std::vector<int>& getDestinations() const;
+
+	//!The open list, a heap for std::push_heap() and co, emptied by begin()
+	inline std::vector<PathHeapEntry>& getOpen();
+
+	//!A plain queue for breadth-first searches, emptied by begin()
+	inline std::vector<int>& getQueue();
+
+private:
+	enum Flags : std::uint8_t
+	{
+		Closed = 1,
+		Destination = 2
+	};
+
+	//!Brings node into this search, if it isn't already
+	inline void touch(int node);
+
+	std::vector<std::uint32_t> stamps;
+	std::vector<std::uint8_t> flags;
+	std::vector<float> costs;
+	std::vector<int> prevs;
+	std::vector<int> destinations;
+	std::vector<PathHeapEntry> open;
+	std::vector<int> queue;
+	//!Nodes whose stamp isn't this haven't been touched this search
+	std::uint32_t generation;
+};
+
+/*			inline implementation			*/
+bool PathSearchContext::isSeen(int node) const
+{
+	//	destinations are touched before they're reached, so the stamp alone isn't enough
+	return stamps[node] == generation && prevs[node] != -1;
+}
+
+bool PathSearchContext::isClosed(int node) const
+{
+	return stamps[node] == generation && (flags[node] & Closed);
+}
+
+bool PathSearchContext::isDestination(int node) const
+{
+	return stamps[node] == generation && (flags[node] & Destination);
+}
+
+float PathSearchContext::getCost(int node) const
+{
+	return stamps[node] == generation ? costs[node] : std::numeric_limits<float>::infinity();
+}
+
+int PathSearchContext::getPrev(int node) const
+{
+	return prevs[node];
+}
+
+void PathSearchContext::setCost(int node, float cost, int prev)
+{
+	touch(node);
+	costs[node] = cost;
+	prevs[node] = prev;
+}
+
+void PathSearchContext::close(int node)
+{
+	touch(node);
+	flags[node] |= Closed;
+}
+
+bool PathSearchContext::addDestination(int node)
+{
+	touch(node);
+	if (flags[node] & Destination)
+		return false;
+	flags[node] |= Destination;
+	destinations.push_back(node);
+	return true;
+}
+
+const std::vector<int>& PathSearchContext::getDestinations() const
+{
+	return destinations;
+}
+
+std::vector<PathHeapEntry>& PathSearchContext::getOpen()
+{
+	return open;
+}
+
+std::vector<int>& PathSearchContext::getQueue()
+{
+	return queue;
+}
+
+void PathSearchContext::touch(int node)
+{
+	if (stamps[node] != generation)
+	{
+		stamps[node] = generation;
+		flags[node] = 0;
+		costs[node] = std::numeric_limits<float>::infinity();
+		prevs[node] = -1;
+	}
+}
+
+} // je
+
+#endif // JE_PATH_SEARCH_CONTEXT_HPP
@@ -2,6 +2,7 @@
 
 #include "jam-engine/Physics/PolygonMask.hpp"
 #include "jam-engine/Physics/CollisionCheckingImplementation.hpp"
+#include "jam-engine/Physics/PixelMask.hpp"
 #include "jam-engine/Utility/Assert.hpp"
 #include "jam-engine/Utility/Trig.hpp"
 
@@ -63,7 +64,22 @@ bool CircleMask::intersects(const DetailedMask& other) const
 		case Type::Circle:
 			return intersectsCircleOnCircle(*this, static_cast<const CircleMask&>(other));
 		case Type::Pixel:
-			return true;
+			return intersectsCircleOnPixel(*this, static_cast<const PixelMask&>(other));
+	}
+	return false;
+}
+
+bool CircleMask::sweep(const DetailedMask& other, const sf::Vector2f& veloc, SweepHit& hit) const
+{
+	switch (other.type)
+	{
+		case Type::Polygon:
+			return sweepCircleOnPolygon(*this, static_cast<const PolygonMask&>(other), veloc, hit);
+		case Type::Circle:
+			return sweepCircleOnCircle(*this, static_cast<const CircleMask&>(other), veloc, hit);
+		case Type::Pixel:
+			//	CollisionMask falls back on the bounding boxes for these
+			return false;
 	}
 	return false;
 }
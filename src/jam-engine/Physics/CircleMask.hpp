@@ -30,8 +30,18 @@ public:
 
 	void projectAgainstHyerplane(double& min, double& max, double angle) const;
 
+	/**
+	 * Projects the circle onto an axis
+	 * @param axis A unit vector
+	 * @param min Set to the lowest projection
+	 * @param max Set to the highest projection
+	 */
+	inline void project(const sf::Vector2f& axis, float& min, float& max) const;
+
 	bool intersects(const DetailedMask& other) const override;
 
+	bool sweep(const DetailedMask& other, const sf::Vector2f& veloc, SweepHit& hit) const override;
+
 	void getAABB(int& minX, int& maxX, int& minY, int& maxY) const override;
 
 	void updateTransform(const sf::Transform& transform) override;
@@ -58,6 +68,14 @@ private:
 	friend bool intersectsPolygonOnCircle(const PolygonMask&, const CircleMask&);
 };
 
+/*		inline implementation		*/
+void CircleMask::project(const sf::Vector2f& axis, float& min, float& max) const
+{
+	const float projection = center.x * axis.x + center.y * axis.y;
+	min = projection - radius;
+	max = projection + radius;
+}
+
 } // je
 
 #endif
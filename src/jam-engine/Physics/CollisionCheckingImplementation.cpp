@@ -1,35 +1,212 @@
 #include "jam-engine/Physics/CollisionCheckingImplementation.hpp"
 
+#include <array>
+#include <cmath>
+#include <limits>
+#include <vector>
+
 #include "jam-engine/Physics/CircleMask.hpp"
+#include "jam-engine/Physics/PixelMask.hpp"
 #include "jam-engine/Physics/PolygonMask.hpp"
+#include "jam-engine/Utility/Math.hpp"
 #include "jam-engine/Utility/Trig.hpp"
 
 namespace je
 {
 
-bool intersectsPolygonOnPolygon(const PolygonMask& a, const PolygonMask& b)
+static const float infinity = std::numeric_limits<float>::infinity();
+
+//	accumulates a swept separating axis test one axis at a time
+struct AxisSweep
 {
-	double thisMin = 0, thisMax = 0, otherMin = 0, otherMax = 0;
+	AxisSweep()
+		:enter(-infinity)
+		,exit(infinity)
+		,enterNormal()
+		,penetration(infinity)
+		,penetrationNormal()
+	{
+	}
 
-	double angle = 0;
+	/**
+	 * Narrows [enter, exit] down to when the projections onto axis overlap
+	 * @param axis A unit axis
+	 * @param speed The moving mask's velocity projected onto axis
+	 * @return false if the masks are separated along this axis for the whole sweep
+	 */
+	bool add(const sf::Vector2f& axis, float movingMin, float movingMax, float targetMin, float targetMax, float speed)
+	{
+		float axisEnter, axisExit;
+		sf::Vector2f normal;
+		if (movingMax <= targetMin)
+		{
+			if (speed <= 0.f)
+				return false;
+			axisEnter = (targetMin - movingMax) / speed;
+			axisExit = (targetMax - movingMin) / speed;
+			normal = -axis;
+		}
+		else if (movingMin >= targetMax)
+		{
+			if (speed >= 0.f)
+				return false;
+			axisEnter = (targetMax - movingMin) / speed;
+			axisExit = (targetMin - movingMax) / speed;
+			normal = axis;
+		}
+		else
+		{
+			axisEnter = -infinity;
+			axisExit = speed > 0.f ? (targetMax - movingMin) / speed : (speed < 0.f ? (targetMin - movingMax) / speed : infinity);
+			//	in case they overlap along every axis, push out along whichever is shallowest
+			if (movingMax - targetMin < penetration)
+			{
+				penetration = movingMax - targetMin;
+				penetrationNormal = -axis;
+			}
+			if (targetMax - movingMin < penetration)
+			{
+				penetration = targetMax - movingMin;
+				penetrationNormal = axis;
+			}
+		}
+		if (axisEnter > enter)
+		{
+			enter = axisEnter;
+			enterNormal = normal;
+		}
+		if (axisExit < exit)
+			exit = axisExit;
+		//	only touching for an instant isn't a hit
+		return enter < exit;
+	}
 
-	int size = a.points.size();
-	for (int i = 0; i < size; ++i)
+	/**
+	 * @return Whether the masks hit within the sweep, filling in the time and normal if so
+	 */
+	bool finish(DetailedMask::SweepHit& hit) const
 	{
-		angle = pointDirection(a.points[i], a.points[(i + 1) % size]) + 90.f;
-		a.projectAgainstHyerplane(thisMin, thisMax, angle);
-		b.projectAgainstHyerplane(otherMin, otherMax, angle);
-		if (thisMin >= otherMax || thisMax < otherMin)
+		if (enter > 1.f)
 			return false;
+		if (enter < 0.f)
+		{
+			hit.time = 0.f;
+			hit.normal = penetrationNormal;
+		}
+		else
+		{
+			hit.time = enter;
+			hit.normal = enterNormal;
+		}
+		return true;
 	}
 
-	size = b.points.size();
-	for (int i = 0; i < size; ++i)
+	float enter, exit;
+	sf::Vector2f enterNormal;
+	float penetration;
+	sf::Vector2f penetrationNormal;
+};
+
+//	for polygons sharing an edge direction (eg two rectangles) there's no point testing it twice
+static bool isParallelToAny(const sf::Vector2f& axis, const std::vector<sf::Vector2f>& axes)
+{
+	for (const sf::Vector2f& other : axes)
+		if (std::abs(axis.x * other.y - axis.y * other.x) < 0.0001f)
+			return true;
+	return false;
+}
+
+//	tests each axis as a separating axis, skipping any parallel to one in skip (if given)
+static bool sweepAxes(AxisSweep& sweep, const std::vector<sf::Vector2f>& axes, const std::vector<sf::Vector2f> *skip, const PolygonMask& moving, const PolygonMask& target, const sf::Vector2f& veloc)
+{
+	for (const sf::Vector2f& axis : axes)
+	{
+		if (skip && isParallelToAny(axis, *skip))
+			continue;
+		float movingMin, movingMax, targetMin, targetMax;
+		moving.project(axis, movingMin, movingMax);
+		target.project(axis, targetMin, targetMax);
+		if (!sweep.add(axis, movingMin, movingMax, targetMin, targetMax, dot(veloc, axis)))
+			return false;
+	}
+	return true;
+}
+
+/**
+ * Finds where two polygons touch once moving has been moved by offset
+ * @param normal The hit normal, facing moving
+ */
+template <typename Points>
+static sf::Vector2f contactPoint(const Points& moving, const sf::Vector2f& offset, const Points& target, const sf::Vector2f& normal)
+{
+	//	the touching features are the points furthest towards each other along the normal
+	const float epsilon = 0.01f;
+	const sf::Vector2f tangent(-normal.y, normal.x);
+	float movingDepth = infinity;
+	for (const sf::Vector2f& p : moving)
+		movingDepth = min(movingDepth, dot(p + offset, normal));
+	float targetDepth = -infinity;
+	for (const sf::Vector2f& p : target)
+		targetDepth = max(targetDepth, dot(p, normal));
+
+	int movingCount = 0, targetCount = 0;
+	float movingLow = infinity, movingHigh = -infinity, targetLow = infinity, targetHigh = -infinity;
+	sf::Vector2f movingPoint, targetPoint;
+	for (const sf::Vector2f& p : moving)
 	{
-		angle = pointDirection(b.points[i], b.points[(i + 1) % size]) + 90.f;
-		a.projectAgainstHyerplane(thisMin, thisMax, angle);
-		b.projectAgainstHyerplane(otherMin, otherMax, angle);
-		if (thisMin >= otherMax || thisMax < otherMin)
+		if (dot(p + offset, normal) <= movingDepth + epsilon)
+		{
+			movingPoint = p + offset;
+			movingLow = min(movingLow, dot(movingPoint, tangent));
+			movingHigh = max(movingHigh, dot(movingPoint, tangent));
+			++movingCount;
+		}
+	}
+	for (const sf::Vector2f& p : target)
+	{
+		if (dot(p, normal) >= targetDepth - epsilon)
+		{
+			targetPoint = p;
+			targetLow = min(targetLow, dot(p, tangent));
+			targetHigh = max(targetHigh, dot(p, tangent));
+			++targetCount;
+		}
+	}
+	//	a vertex on either side is the contact, otherwise it's two edges so use the middle of their overlap
+	if (movingCount == 1)
+		return movingPoint;
+	if (targetCount == 1)
+		return targetPoint;
+	const float along = (max(movingLow, targetLow) + min(movingHigh, targetHigh)) / 2.f;
+	return normal * targetDepth + tangent * along;
+}
+
+static sf::Vector2f normalize(const sf::Vector2f& vec)
+{
+	const float len = length(vec);
+	return len > 0.f ? vec / len : sf::Vector2f(0.f, 0.f);
+}
+
+bool intersectsPolygonOnPolygon(const PolygonMask& a, const PolygonMask& b)
+{
+	//	each axis is only tested facing one way, so touching has to count as separated on both sides
+	float thisMin, thisMax, otherMin, otherMax;
+
+	for (const sf::Vector2f& axis : a.getAxes())
+	{
+		a.project(axis, thisMin, thisMax);
+		b.project(axis, otherMin, otherMax);
+		if (thisMin >= otherMax || thisMax <= otherMin)
+			return false;
+	}
+
+	for (const sf::Vector2f& axis : b.getAxes())
+	{
+		if (isParallelToAny(axis, a.getAxes()))
+			continue;
+		a.project(axis, thisMin, thisMax);
+		b.project(axis, otherMin, otherMax);
+		if (thisMin >= otherMax || thisMax <= otherMin)
 			return false;
 	}
 
@@ -38,17 +215,13 @@ bool intersectsPolygonOnPolygon(const PolygonMask& a, const PolygonMask& b)
 
 bool intersectsPolygonOnCircle(const PolygonMask& polygon, const CircleMask& circle)
 {
-	double thisMin = 0, thisMax = 0, otherMin = 0, otherMax = 0;
-
-	double angle = 0;
+	float thisMin, thisMax, otherMin, otherMax;
 
-	int size = polygon.points.size();
-	for (int i = 0; i < size; ++i)
+	for (const sf::Vector2f& axis : polygon.getAxes())
 	{
-		angle = pointDirection(polygon.points[i], polygon.points[(i + 1) % size]) + 90.f;
-		polygon.projectAgainstHyerplane(thisMin, thisMax, angle);
-		circle.projectAgainstHyerplane(otherMin, otherMax, angle);
-		if (thisMin >= otherMax || thisMax < otherMin)
+		polygon.project(axis, thisMin, thisMax);
+		circle.project(axis, otherMin, otherMax);
+		if (thisMin >= otherMax || thisMax <= otherMin)
 			return false;
 	}
 	return true;
@@ -59,4 +232,249 @@ bool intersectsCircleOnCircle(const CircleMask& a, const CircleMask& b)
 	return je::length(a.getPos() - b.getPos()) <= a.getRadius() + b.getRadius();
 }
 
+bool intersectsPolygonOnPixel(const PolygonMask& polygon, const PixelMask& pixels)
+{
+	int minX, maxX, minY, maxY;
+	polygon.getAABB(minX, maxX, minY, maxY);
+	const sf::Vector2i& pos = pixels.getPos();
+	const int top = max(minY - 1, pos.y);
+	const int bottom = min(maxY + 1, pos.y + pixels.getBitmap().getHeight());
+	const PolygonMask::Points& points = polygon.points;
+	for (int y = top; y < bottom; ++y)
+	{
+		//	the polygon is convex, so it covers a single span of each row of pixel centres
+		const float centre = y + 0.5f;
+		float spanMin = infinity, spanMax = -infinity;
+		for (std::size_t i = 0; i < points.size(); ++i)
+		{
+			const sf::Vector2f& p = points[i];
+			const sf::Vector2f& q = points[(i + 1) % points.size()];
+			if ((p.y <= centre && q.y >= centre) || (q.y <= centre && p.y >= centre))
+			{
+				//	an edge lying along the row covers all of itself
+				const float x1 = p.y == q.y ? p.x : p.x + (centre - p.y) * (q.x - p.x) / (q.y - p.y);
+				const float x2 = p.y == q.y ? q.x : x1;
+				spanMin = min(spanMin, min(x1, x2));
+				spanMax = max(spanMax, max(x1, x2));
+			}
+		}
+		if (spanMin <= spanMax && pixels.anyInRow(y, std::ceil(spanMin - 0.5f), std::floor(spanMax - 0.5f)))
+			return true;
+	}
+	return false;
+}
+
+bool intersectsCircleOnPixel(const CircleMask& circle, const PixelMask& pixels)
+{
+	const sf::Vector2f& centre = circle.getPos();
+	const float radius = circle.getRadius();
+	const sf::Vector2i& pos = pixels.getPos();
+	const int top = max<int>(std::floor(centre.y - radius), pos.y);
+	const int bottom = min<int>(std::ceil(centre.y + radius), pos.y + pixels.getBitmap().getHeight());
+	for (int y = top; y < bottom; ++y)
+	{
+		const float dy = y + 0.5f - centre.y;
+		if (dy * dy > radius * radius)
+			continue;
+		const float halfWidth = std::sqrt(radius * radius - dy * dy);
+		if (pixels.anyInRow(y, std::ceil(centre.x - halfWidth - 0.5f), std::floor(centre.x + halfWidth - 0.5f)))
+			return true;
+	}
+	return false;
+}
+
+bool intersectsPixelOnPixel(const PixelMask& a, const PixelMask& b)
+{
+	const PixelMask::Bitmap& aBits = a.getBitmap();
+	const PixelMask::Bitmap& bBits = b.getBitmap();
+	const sf::Vector2i& aPos = a.getPos();
+	const sf::Vector2i& bPos = b.getPos();
+	const int left = max(aPos.x, bPos.x);
+	const int right = min(aPos.x + aBits.getWidth(), bPos.x + bBits.getWidth());
+	const int top = max(aPos.y, bPos.y);
+	const int bottom = min(aPos.y + aBits.getHeight(), bPos.y + bBits.getHeight());
+	//	64 pixels of each row at a time. Past right one of the two always reads as 0, so no masking is needed
+	for (int y = top; y < bottom; ++y)
+		for (int x = left; x < right; x += 64)
+			if (aBits.getBits(x - aPos.x, y - aPos.y) & bBits.getBits(x - bPos.x, y - bPos.y))
+				return true;
+	return false;
+}
+
+bool sweepPolygonOnPolygon(const PolygonMask& moving, const PolygonMask& target, const sf::Vector2f& veloc, DetailedMask::SweepHit& hit)
+{
+	//	neither polygon rotates during the sweep, so the separating axis test still only needs their axes
+	AxisSweep sweep;
+	if (!sweepAxes(sweep, moving.getAxes(), nullptr, moving, target, veloc) ||
+	    !sweepAxes(sweep, target.getAxes(), &moving.getAxes(), moving, target, veloc) ||
+	    !sweep.finish(hit))
+		return false;
+	hit.contact = contactPoint(moving.points, veloc * hit.time, target.points, hit.normal);
+	return true;
+}
+
+bool sweepPolygonOnCircle(const PolygonMask& moving, const CircleMask& target, const sf::Vector2f& veloc, DetailedMask::SweepHit& hit)
+{
+	if (!sweepCircleOnPolygon(target, moving, -veloc, hit))
+		return false;
+	//	that was the circle moving back into the polygon, so turn it back around
+	hit.contact += veloc * hit.time;
+	hit.normal = -hit.normal;
+	return true;
+}
+
+bool sweepCircleOnPolygon(const CircleMask& moving, const PolygonMask& target, const sf::Vector2f& veloc, DetailedMask::SweepHit& hit)
+{
+	//	the circle's center is cast as a ray against the polygon grown by the radius, whose
+	//	boundary is the edges pushed out by the radius joined by circles around the vertices
+	const PolygonMask::Points& points = target.points;
+	const int size = points.size();
+	const sf::Vector2f center = moving.getPos();
+	const float radius = moving.getRadius();
+	sf::Vector2f centroid;
+	for (const sf::Vector2f& p : points)
+		centroid += p;
+	centroid /= static_cast<float>(size);
+
+	//	already overlapping?
+	bool inside = true;
+	float closestDistance = infinity;
+	sf::Vector2f closestPoint;
+	float shallowestDepth = infinity;
+	sf::Vector2f shallowestNormal;
+	for (int i = 0; i < size; ++i)
+	{
+		const sf::Vector2f& a = points[i];
+		const sf::Vector2f edge = points[(i + 1) % size] - a;
+		const float edgeLengthSquared = dot(edge, edge);
+		if (edgeLengthSquared == 0.f)
+			continue;
+		sf::Vector2f normal = normalize(sf::Vector2f(-edge.y, edge.x));
+		if (dot(normal, a - centroid) < 0.f)
+			normal = -normal;
+		const float distance = dot(center - a, normal);
+		if (distance > 0.f)
+			inside = false;
+		else if (-distance < shallowestDepth)
+		{
+			shallowestDepth = -distance;
+			shallowestNormal = normal;
+		}
+		float along = dot(center - a, edge) / edgeLengthSquared;
+		limit(along, 0.f, 1.f);
+		const sf::Vector2f onEdge = a + edge * along;
+		if (length(center - onEdge) < closestDistance)
+		{
+			closestDistance = length(center - onEdge);
+			closestPoint = onEdge;
+		}
+	}
+	if (inside || closestDistance < radius)
+	{
+		hit.time = 0.f;
+		hit.normal = inside ? shallowestNormal : normalize(center - closestPoint);
+		hit.contact = closestPoint;
+		return true;
+	}
+
+	float best = infinity;
+	for (int i = 0; i < size; ++i)
+	{
+		const sf::Vector2f& a = points[i];
+		const sf::Vector2f edge = points[(i + 1) % size] - a;
+		const float edgeLengthSquared = dot(edge, edge);
+		if (edgeLengthSquared == 0.f)
+			continue;
+		sf::Vector2f normal = normalize(sf::Vector2f(-edge.y, edge.x));
+		if (dot(normal, a - centroid) < 0.f)
+			normal = -normal;
+		const float distance = dot(center - a, normal);
+		const float speed = dot(veloc, normal);
+		if (distance >= radius && speed < 0.f)
+		{
+			const float t = (radius - distance) / speed;
+			const sf::Vector2f reached = center + veloc * t;
+			const float along = dot(reached - a, edge);
+			if (t <= 1.f && t < best && along >= 0.f && along <= edgeLengthSquared)
+			{
+				best = t;
+				hit.normal = normal;
+				hit.contact = reached - normal * radius;
+			}
+		}
+	}
+	for (const sf::Vector2f& p : points)
+	{
+		//	solve |center + veloc * t - p| = radius for the earlier t
+		const sf::Vector2f offset = center - p;
+		const float a = dot(veloc, veloc);
+		const float b = 2.f * dot(offset, veloc);
+		const float c = dot(offset, offset) - radius * radius;
+		if (a == 0.f || b >= 0.f)
+			continue;
+		const float discriminant = b * b - 4.f * a * c;
+		if (discriminant < 0.f)
+			continue;
+		const float t = (-b - sqrt(discriminant)) / (2.f * a);
+		if (t >= 0.f && t <= 1.f && t < best)
+		{
+			best = t;
+			hit.contact = p;
+			hit.normal = radius > 0.f ? normalize(offset + veloc * t) : normalize(-veloc);
+		}
+	}
+	if (best > 1.f)
+		return false;
+	hit.time = best;
+	return true;
+}
+
+bool sweepCircleOnCircle(const CircleMask& moving, const CircleMask& target, const sf::Vector2f& veloc, DetailedMask::SweepHit& hit)
+{
+	const sf::Vector2f offset = moving.getPos() - target.getPos();
+	const float radii = moving.getRadius() + target.getRadius();
+	const float c = dot(offset, offset) - radii * radii;
+	if (c < 0.f)
+	{
+		hit.time = 0.f;
+		hit.normal = normalize(offset);
+		hit.contact = target.getPos() + hit.normal * target.getRadius();
+		return true;
+	}
+	const float a = dot(veloc, veloc);
+	const float b = 2.f * dot(offset, veloc);
+	if (a == 0.f || b >= 0.f)
+		return false;
+	const float discriminant = b * b - 4.f * a * c;
+	if (discriminant < 0.f)
+		return false;
+	const float t = (-b - sqrt(discriminant)) / (2.f * a);
+	if (t > 1.f)
+		return false;
+	hit.time = t;
+	hit.normal = normalize(offset + veloc * t);
+	hit.contact = target.getPos() + hit.normal * target.getRadius();
+	return true;
+}
+
+bool sweepAABBOnAABB(const sf::FloatRect& moving, const sf::FloatRect& target, const sf::Vector2f& veloc, DetailedMask::SweepHit& hit)
+{
+	AxisSweep sweep;
+	if (!sweep.add(sf::Vector2f(1.f, 0.f), moving.left, moving.left + moving.width, target.left, target.left + target.width, veloc.x) ||
+	    !sweep.add(sf::Vector2f(0.f, 1.f), moving.top, moving.top + moving.height, target.top, target.top + target.height, veloc.y) ||
+	    !sweep.finish(hit))
+		return false;
+	const sf::Vector2f offset = veloc * hit.time;
+	const std::array<sf::Vector2f, 4> movingCorners = {{
+		sf::Vector2f(moving.left, moving.top), sf::Vector2f(moving.left + moving.width, moving.top),
+		sf::Vector2f(moving.left + moving.width, moving.top + moving.height), sf::Vector2f(moving.left, moving.top + moving.height)
+	}};
+	const std::array<sf::Vector2f, 4> targetCorners = {{
+		sf::Vector2f(target.left, target.top), sf::Vector2f(target.left + target.width, target.top),
+		sf::Vector2f(target.left + target.width, target.top + target.height), sf::Vector2f(target.left, target.top + target.height)
+	}};
+	hit.contact = contactPoint(movingCorners, offset, targetCorners, hit.normal);
+	return true;
+}
+
 } // je
@@ -1,6 +1,11 @@
 #ifndef JE_COLLISION_CHECKING_IMPLEMENTATION_HPP
 #define JE_COLLISION_CHECKING_IMPLEMENTATION_HPP
 
+#include <SFML/Graphics/Rect.hpp>
+#include <SFML/System/Vector2.hpp>
+
+#include "jam-engine/Physics/DetailedMask.hpp"
+
 namespace je
 {
 
@@ -8,12 +13,34 @@ class PolygonMask;
 
 class CircleMask;
 
+class PixelMask;
+
 bool intersectsPolygonOnPolygon(const PolygonMask& a, const PolygonMask& b);
 
 bool intersectsPolygonOnCircle(const PolygonMask& polygon, const CircleMask& circle);
 
 bool intersectsCircleOnCircle(const CircleMask& a, const CircleMask& b);
 
+//	the pixel tests count a pixel as covered by a polygon or circle if its centre is inside it
+
+bool intersectsPolygonOnPixel(const PolygonMask& polygon, const PixelMask& pixels);
+
+bool intersectsCircleOnPixel(const CircleMask& circle, const PixelMask& pixels);
+
+bool intersectsPixelOnPixel(const PixelMask& a, const PixelMask& b);
+
+//	the sweeps below move the first mask along veloc against the second one, see DetailedMask::sweep()
+
+bool sweepPolygonOnPolygon(const PolygonMask& moving, const PolygonMask& target, const sf::Vector2f& veloc, DetailedMask::SweepHit& hit);
+
+bool sweepPolygonOnCircle(const PolygonMask& moving, const CircleMask& target, const sf::Vector2f& veloc, DetailedMask::SweepHit& hit);
+
+bool sweepCircleOnPolygon(const CircleMask& moving, const PolygonMask& target, const sf::Vector2f& veloc, DetailedMask::SweepHit& hit);
+
+bool sweepCircleOnCircle(const CircleMask& moving, const CircleMask& target, const sf::Vector2f& veloc, DetailedMask::SweepHit& hit);
+
+bool sweepAABBOnAABB(const sf::FloatRect& moving, const sf::FloatRect& target, const sf::Vector2f& veloc, DetailedMask::SweepHit& hit);
+
 } // je
 
 #endif
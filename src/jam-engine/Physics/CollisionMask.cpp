@@ -1,5 +1,7 @@
 #include "jam-engine/Physics/CollisionMask.hpp"
 
+#include "jam-engine/Physics/CollisionCheckingImplementation.hpp"
+
 namespace je
 {
 
@@ -9,6 +11,18 @@ CollisionMask::CollisionMask(DetailedMask::MaskRef mask)
 	detailedMask->getAABB(minX, maxX, minY, maxY);
 }
 
+bool CollisionMask::sweep(const CollisionMask& other, const sf::Vector2f& veloc, DetailedMask::SweepHit& hit) const
+{
+	//	the integer bounds can be up to a pixel short of the real ones, so pad them when rejecting
+	const sf::FloatRect movingBounds(minX - 1, minY - 1, maxX - minX + 2, maxY - minY + 2);
+	const sf::FloatRect otherBounds(other.minX - 1, other.minY - 1, other.maxX - other.minX + 2, other.maxY - other.minY + 2);
+	if (!sweepAABBOnAABB(movingBounds, otherBounds, veloc, hit))
+		return false;
+	if (detailedMask->type == DetailedMask::Type::Pixel || other.detailedMask->type == DetailedMask::Type::Pixel)
+		return sweepAABBOnAABB(sf::FloatRect(minX, minY, maxX - minX, maxY - minY), sf::FloatRect(other.minX, other.minY, other.maxX - other.minX, other.maxY - other.minY), veloc, hit);
+	return detailedMask->sweep(*other.detailedMask, veloc, hit);
+}
+
 void CollisionMask::updateTransform(const sf::Transform& transform)
 {
 	detailedMask->updateTransform(transform);
@@ -3,6 +3,7 @@
 
 #include <memory>
 
+#include <SFML/Graphics/Rect.hpp>
 #include <SFML/Graphics/Transform.hpp>
 
 #include "jam-engine/Physics/DetailedMask.hpp"
@@ -22,10 +23,21 @@ public:
 		return bBox.left < maxX && bBox.left + bBox.width >= minX && bBox.top < maxY && bBox.top + bBox.height >= minY;
 	}
 
+	/**
+	 * Finds when this mask first touches other as it moves along veloc. See DetailedMask::sweep()
+	 * @param other The mask to test against, which stays where it is
+	 * @param veloc How far this mask moves
+	 * @param hit Set to the time, contact and normal of the hit if there was one
+	 * @return Whether they touch before the end of veloc
+	 */
+	bool sweep(const CollisionMask& other, const sf::Vector2f& veloc, DetailedMask::SweepHit& hit) const;
+
 	void updateTransform(const sf::Transform& transform);
 
 	inline const DetailedMask& getDetails() const;
 
+	sf::Rect<int> getAABB() const { return sf::Rect<int>(minX, minY, maxX - minX, maxY - minY); }
+
 	// TODO : remove?
 	int getWidth() const { return maxX - minX; }
 	int getHeight() const { return maxY - minY; }
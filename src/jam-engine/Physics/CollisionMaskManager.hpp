@@ -19,6 +19,10 @@ public:
 
 	void add(const std::string& name, DetailedMask::MaskRef& mask);
 
+	/**
+	 * @return A copy of the mask added as name. Copies share the original's untransformed geometry,
+	 * so making lots of them is cheap.
+	 */
 	DetailedMask::MaskRef create(const std::string& name) const;
 
 private:
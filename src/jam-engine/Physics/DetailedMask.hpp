@@ -7,6 +7,7 @@
 	#include <SFML/Graphics/RenderTarget.hpp>
 #endif
 #include <SFML/Graphics/Transform.hpp>
+#include <SFML/System/Vector2.hpp>
 
 namespace je
 {
@@ -22,6 +23,17 @@ public:
 		Pixel
 	};
 
+	//!Where and when a moving mask first touches another one
+	struct SweepHit
+	{
+		//!How far along the velocity the masks touch, from 0 to 1. 0 if they already overlapped
+		float time;
+		//!The point of contact when they touch
+		sf::Vector2f contact;
+		//!The unit surface normal of the mask that was hit, facing the moving one
+		sf::Vector2f normal;
+	};
+
 
 	virtual ~DetailedMask()
 	{
@@ -29,6 +41,16 @@ public:
 
 	virtual bool intersects(const DetailedMask& other) const = 0;
 
+	/**
+	 * Finds when this mask first touches other as it moves along veloc. Just touching (and
+	 * sliding along an edge) isn't a hit, so things resting against each other can move apart.
+	 * @param other The mask to test against, which stays where it is
+	 * @param veloc How far this mask moves
+	 * @param hit Set to the time, contact and normal of the hit if there was one
+	 * @return Whether they touch before the end of veloc
+	 */
+	virtual bool sweep(const DetailedMask& other, const sf::Vector2f& veloc, SweepHit& hit) const = 0;
+
 	virtual void getAABB(int& minX, int& maxX, int& minY, int& maxY) const = 0;
 
 	virtual void updateTransform(const sf::Transform& transform) = 0;
@@ -0,0 +1,158 @@
+#include "jam-engine/Physics/PixelMask.hpp"
+
+#include <cmath>
+
+#include "jam-engine/Physics/CircleMask.hpp"
+#include "jam-engine/Physics/CollisionCheckingImplementation.hpp"
+#include "jam-engine/Physics/PolygonMask.hpp"
+#include "jam-engine/Utility/Assert.hpp"
+
+namespace je
+{
+
+PixelMask::Bitmap::Bitmap(const sf::Image& image, const sf::IntRect& rect, sf::Uint8 alphaThreshold)
+	:width(rect.width > 0 ? rect.width : image.getSize().x)
+	,height(rect.height > 0 ? rect.height : image.getSize().y)
+	,wordsPerRow((width + 63) / 64)
+	,words(wordsPerRow * height, 0)
+{
+	const int left = rect.width > 0 ? rect.left : 0;
+	const int top = rect.height > 0 ? rect.top : 0;
+	JE_ASSERT(left >= 0 && top >= 0 && left + width <= (int) image.getSize().x && top + height <= (int) image.getSize().y);
+	for (int y = 0; y < height; ++y)
+	{
+		std::uint64_t *row = &words[y * wordsPerRow];
+		for (int x = 0; x < width; ++x)
+			if (image.getPixel(left + x, top + y).a > alphaThreshold)
+				row[x >> 6] |= std::uint64_t(1) << (x & 63);
+	}
+}
+
+int PixelMask::Bitmap::getWidth() const
+{
+	return width;
+}
+
+int PixelMask::Bitmap::getHeight() const
+{
+	return height;
+}
+
+bool PixelMask::Bitmap::isSolid(int x, int y) const
+{
+	return getBits(x, y) & 1;
+}
+
+
+
+PixelMask::PixelMask(BitmapRef bitmap)
+	:DetailedMask(Type::Pixel)
+	,bitmap(std::move(bitmap))
+	,pos(0, 0)
+#ifdef JE_DEBUG
+	,debugPixels(sf::PrimitiveType::Points)
+#endif
+{
+	JE_ASSERT(this->bitmap);
+#ifdef JE_DEBUG
+	for (int y = 0; y < this->bitmap->getHeight(); ++y)
+		for (int x = 0; x < this->bitmap->getWidth(); ++x)
+			if (this->bitmap->isSolid(x, y))
+				debugPixels.append(sf::Vertex(sf::Vector2f(x + 0.5f, y + 0.5f), sf::Color(0, 128, 255, 128)));
+#endif
+}
+
+PixelMask::PixelMask(const sf::Image& image, sf::Uint8 alphaThreshold)
+	:PixelMask(std::make_shared<const Bitmap>(image, sf::IntRect(), alphaThreshold))
+{
+}
+
+const PixelMask::Bitmap& PixelMask::getBitmap() const
+{
+	return *bitmap;
+}
+
+const sf::Vector2i& PixelMask::getPos() const
+{
+	return pos;
+}
+
+bool PixelMask::anyInRow(int y, int minX, int maxX) const
+{
+	const int row = y - pos.y;
+	int x = (minX > pos.x ? minX : pos.x) - pos.x;
+	const int end = (maxX < pos.x + bitmap->getWidth() - 1 ? maxX : pos.x + bitmap->getWidth() - 1) - pos.x + 1;
+	for (; x < end; x += 64)
+	{
+		std::uint64_t bits = bitmap->getBits(x, row);
+		//	don't count anything past maxX in the last word
+		if (end - x < 64)
+			bits &= (std::uint64_t(1) << (end - x)) - 1;
+		if (bits)
+			return true;
+	}
+	return false;
+}
+
+bool PixelMask::intersects(const DetailedMask& other) const
+{
+	switch (other.type)
+	{
+		case Type::Polygon:
+			return intersectsPolygonOnPixel(static_cast<const PolygonMask&>(other), *this);
+		case Type::Circle:
+			return intersectsCircleOnPixel(static_cast<const CircleMask&>(other), *this);
+		case Type::Pixel:
+			return intersectsPixelOnPixel(*this, static_cast<const PixelMask&>(other));
+	}
+	return false;
+}
+
+bool PixelMask::sweep(const DetailedMask& other, const sf::Vector2f& veloc, SweepHit& hit) const
+{
+	//	sweeping the pixels themselves isn't worth it, so go by the bounding boxes like CollisionMask does
+	int otherMinX, otherMaxX, otherMinY, otherMaxY;
+	other.getAABB(otherMinX, otherMaxX, otherMinY, otherMaxY);
+	return sweepAABBOnAABB(sf::FloatRect(pos.x, pos.y, bitmap->getWidth(), bitmap->getHeight()),
+	                       sf::FloatRect(otherMinX, otherMinY, otherMaxX - otherMinX, otherMaxY - otherMinY),
+	                       veloc, hit);
+}
+
+void PixelMask::getAABB(int& minX, int& maxX, int& minY, int& maxY) const
+{
+	minX = pos.x;
+	maxX = pos.x + bitmap->getWidth();
+	minY = pos.y;
+	maxY = pos.y + bitmap->getHeight();
+}
+
+void PixelMask::updateTransform(const sf::Transform& transform)
+{
+	const sf::Vector2f origin(transform.transformPoint(0.f, 0.f));
+	const sf::Vector2f unit(transform.transformPoint(1.f, 1.f) - origin);
+	const float epsilon = 0.001f;
+	JE_ASSERT_MSG(std::abs(unit.x - 1.f) < epsilon && std::abs(unit.y - 1.f) < epsilon, "PixelMask can't be rotated or scaled");
+	pos.x = std::floor(origin.x + 0.5f);
+	pos.y = std::floor(origin.y + 0.5f);
+}
+
+DetailedMask::MaskRef PixelMask::clone() const
+{
+	return DetailedMask::MaskRef(new PixelMask(*this));
+}
+
+#ifdef JE_DEBUG
+void PixelMask::draw(sf::RenderTarget& target, sf::RenderStates states) const
+{
+	states.transform.translate(pos.x, pos.y);
+	target.draw(debugPixels, states);
+}
+
+void PixelMask::setColor(sf::Color color)
+{
+	for (std::size_t i = 0; i < debugPixels.getVertexCount(); ++i)
+		debugPixels[i].color = color;
+}
+#endif
+
+} // je
@@ -0,0 +1,129 @@
+#ifndef JE_PIXEL_MASK_HPP
+#define JE_PIXEL_MASK_HPP
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#ifdef JE_DEBUG
+	#include <SFML/Graphics/RenderTarget.hpp>
+	#include <SFML/Graphics/VertexArray.hpp>
+#endif
+#include <SFML/Graphics/Image.hpp>
+#include <SFML/Graphics/Rect.hpp>
+#include <SFML/System/Vector2.hpp>
+
+#include "jam-engine/Physics/DetailedMask.hpp"
+
+namespace je
+{
+
+/**
+ * Pixel-perfect mask made from the alpha channel of an image. The pixels are packed 64 to a word
+ * so overlap tests AND whole runs of pixels together. Only the translation of the transform is
+ * followed, so the image can't be rotated or scaled.
+ */
+class PixelMask : public DetailedMask
+{
+public:
+	//!The packed rows of an image. Immutable, so every mask made from the same image can share one
+	class Bitmap
+	{
+	public:
+		/**
+		 * @param image The image to take the alpha channel from
+		 * @param rect The part of the image to use, or all of it if empty
+		 * @param alphaThreshold Pixels with an alpha above this are solid
+		 */
+		Bitmap(const sf::Image& image, const sf::IntRect& rect = sf::IntRect(), sf::Uint8 alphaThreshold = 0);
+
+		int getWidth() const;
+
+		int getHeight() const;
+
+		bool isSolid(int x, int y) const;
+
+		/**
+		 * @param x The column of the first pixel wanted, which can be off either side of the bitmap
+		 * @param y The row
+		 * @return The 64 pixels of row y from column x onwards, with column x in bit 0.
+		 * Anything outside the bitmap reads as 0.
+		 */
+		inline std::uint64_t getBits(int x, int y) const;
+
+	private:
+		int width;
+		int height;
+		int wordsPerRow;
+		//!Row after row of wordsPerRow words, with the padding past width left as 0
+		std::vector<std::uint64_t> words;
+	};
+	typedef std::shared_ptr<const Bitmap> BitmapRef;
+
+	/**
+	 * @param bitmap The pixels to use, usually from TexManager::getBitmap() so they're shared
+	 */
+	PixelMask(BitmapRef bitmap);
+
+	/**
+	 * Packs a new bitmap just for this mask (and its clones)
+	 */
+	PixelMask(const sf::Image& image, sf::Uint8 alphaThreshold = 0);
+
+	const Bitmap& getBitmap() const;
+
+	//!The world position of the bitmap's top-left pixel
+	const sf::Vector2i& getPos() const;
+
+	/**
+	 * @param y The row in world coordinates
+	 * @param minX The first column in world coordinates
+	 * @param maxX The last column in world coordinates (inclusive)
+	 * @return Whether any solid pixel lies in that span of the row
+	 */
+	bool anyInRow(int y, int minX, int maxX) const;
+
+	bool intersects(const DetailedMask& other) const override;
+
+	bool sweep(const DetailedMask& other, const sf::Vector2f& veloc, SweepHit& hit) const override;
+
+	void getAABB(int& minX, int& maxX, int& minY, int& maxY) const override;
+
+	void updateTransform(const sf::Transform& transform) override;
+
+	DetailedMask::MaskRef clone() const override;
+
+#ifdef JE_DEBUG
+	void draw(sf::RenderTarget& target, sf::RenderStates states) const override;
+
+	void setColor(sf::Color color) override;
+#endif
+
+private:
+	BitmapRef bitmap;
+	sf::Vector2i pos;
+#ifdef JE_DEBUG
+	//!One point per solid pixel, relative to pos
+	sf::VertexArray debugPixels;
+#endif
+};
+
+/*		inline implementation		*/
+std::uint64_t PixelMask::Bitmap::getBits(int x, int y) const
+{
+	if (y < 0 || y >= height || x >= width || x <= -64)
+		return 0;
+	if (x < 0)
+		return getBits(0, y) << -x;
+	const std::uint64_t *row = &words[y * wordsPerRow];
+	const int word = x >> 6;
+	const int shift = x & 63;
+	std::uint64_t bits = row[word] >> shift;
+	if (shift != 0 && word + 1 < wordsPerRow)
+		bits |= row[word + 1] << (64 - shift);
+	return bits;
+}
+
+} // je
+
+#endif // JE_PIXEL_MASK_HPP
@@ -1,24 +1,54 @@
 #include "jam-engine/Physics/PolygonMask.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <utility>
+
+#include "jam-engine/Core/EntityPool.hpp"
 #include "jam-engine/Physics/CollisionCheckingImplementation.hpp"
+#include "jam-engine/Physics/PixelMask.hpp"
 #include "jam-engine/Physics/CircleMask.hpp"
+#include "jam-engine/Utility/Assert.hpp"
 #include "jam-engine/Utility/Trig.hpp"
 
 namespace je
 {
 
+//	never freed, since masks can be freed during static destruction after anything that would own it
+static EntityPool& maskPool()
+{
+	static EntityPool *pool = new EntityPool(sizeof(PolygonMask), 256);
+	return *pool;
+}
+
+PolygonMask::Points::Points(const std::vector<sf::Vector2f>& original)
+	:morePoints()
+	,count(original.size())
+{
+	if (count <= JE_POLYGON_INLINE_POINTS)
+		std::copy(original.begin(), original.end(), inlinePoints);
+	else
+		morePoints = original;
+}
+
 PolygonMask::PolygonMask(int width, int height)
+	:PolygonMask(rectangle(width, height))
+{
+}
+
+PolygonMask::PolygonMask(Shape shape)
 	:DetailedMask(Type::Polygon)
-	,points(4)
-	,pointsOriginal(4)
+	,points(shape->points)
+	,shape(std::move(shape))
+	,axes()
+	,ownAxes(false)
 #ifdef JE_DEBUG
 	,debugDrawPoints(sf::PrimitiveType::LinesStrip)
 #endif
 {
-	points[0] = pointsOriginal[0] = sf::Vector2f(0, 0);
-	points[1] = pointsOriginal[1] = sf::Vector2f(width, 0);
-	points[2] = pointsOriginal[2] = sf::Vector2f(width, height);
-	points[3] = pointsOriginal[3] = sf::Vector2f(0, height);
+	JE_ASSERT(points.size() >= 2);
 #ifdef JE_DEBUG
 	for (const sf::Vector2f& vec : points)
 		debugDrawPoints.append(sf::Vertex(vec, sf::Color::Cyan));
@@ -28,14 +58,24 @@ PolygonMask::PolygonMask(int width, int height)
 
 PolygonMask::PolygonMask(const PolygonMask& other)
 	:DetailedMask(Type::Polygon)
-	,points(other.pointsOriginal)
-	,pointsOriginal(other.pointsOriginal)
+	,points(other.shape->points)
+	,shape(other.shape)
+	,axes()
+	,ownAxes(false)
 #ifdef JE_DEBUG
 	,debugDrawPoints(other.debugDrawPoints)
 #endif
 {
 }
 
+PolygonMask::Shape PolygonMask::makeShape(std::vector<sf::Vector2f> points)
+{
+	std::shared_ptr<ShapeData> shape = std::make_shared<ShapeData>();
+	shape->points = std::move(points);
+	computeAxes(shape->points.data(), shape->points.size(), shape->axes);
+	return shape;
+}
+
 void PolygonMask::projectAgainstHyerplane(double& min, double& max, double angle) const
 {
 	//	if we rotate the points by -angle, then our projection against the hyperplane (angle)
@@ -46,7 +86,7 @@ void PolygonMask::projectAgainstHyerplane(double& min, double& max, double angle
 	const double cosAngle = cos(-angle * pi / 180.f);
 	min = max = cosAngle * points.front().x + sinAngle * points.front().y;
 	//	skip the first point since we already did that
-	for (std::vector<sf::Vector2f>::const_iterator it = points.begin() + 1, end = points.end(); it != end; ++it)
+	for (const sf::Vector2f *it = points.begin() + 1, *end = points.end(); it != end; ++it)
 	{
 		const double projectionX = cosAngle * it->x + sinAngle * it->y;
 		if (projectionX < min)
@@ -65,7 +105,22 @@ bool PolygonMask::intersects(const DetailedMask& other) const
 		case Type::Circle:
 			return intersectsPolygonOnCircle(*this, static_cast<const CircleMask&>(other));
 		case Type::Pixel:
-			return true;
+			return intersectsPolygonOnPixel(*this, static_cast<const PixelMask&>(other));
+	}
+	return false;
+}
+
+bool PolygonMask::sweep(const DetailedMask& other, const sf::Vector2f& veloc, SweepHit& hit) const
+{
+	switch (other.type)
+	{
+		case Type::Polygon:
+			return sweepPolygonOnPolygon(*this, static_cast<const PolygonMask&>(other), veloc, hit);
+		case Type::Circle:
+			return sweepPolygonOnCircle(*this, static_cast<const CircleMask&>(other), veloc, hit);
+		case Type::Pixel:
+			//	CollisionMask falls back on the bounding boxes for these
+			return false;
 	}
 	return false;
 }
@@ -75,7 +130,7 @@ void PolygonMask::getAABB(int& minX, int& maxX, int& minY, int& maxY) const
 	maxX = minX = points.front().x;
 	maxY = minY = points.front().y;
 	//	skip the first point since we already did that
-	for (std::vector<sf::Vector2f>::const_iterator it = points.begin() + 1, end = points.end(); it != end; ++it)
+	for (const sf::Vector2f *it = points.begin() + 1, *end = points.end(); it != end; ++it)
 	{
 		if (it->x > maxX)
 			maxX = it->x;
@@ -91,10 +146,11 @@ void PolygonMask::getAABB(int& minX, int& maxX, int& minY, int& maxY) const
 
 void PolygonMask::updateTransform(const sf::Transform& transform)
 {
-	const int size = pointsOriginal.size();
+	const std::vector<sf::Vector2f>& original = shape->points;
+	const int size = original.size();
 	for (int i = 0; i < size; ++i)
 	{
-		points[i] = transform.transformPoint(pointsOriginal[i]);
+		points[i] = transform.transformPoint(original[i]);
 #ifdef JE_DEBUG
 		debugDrawPoints[i].position = points[i];
 #endif
@@ -102,6 +158,59 @@ void PolygonMask::updateTransform(const sf::Transform& transform)
 #ifdef JE_DEBUG
 	debugDrawPoints[size] = debugDrawPoints[0];
 #endif
+	//	a translation leaves the edge normals alone, so only rotations and scales need axes of their own
+	const float *matrix = transform.getMatrix();
+	ownAxes = matrix[0] != 1.f || matrix[1] != 0.f || matrix[4] != 0.f || matrix[5] != 1.f;
+	if (ownAxes)
+		computeAxes(points.data(), size, axes);
+}
+
+/*		private			*/
+PolygonMask::Shape PolygonMask::rectangle(int width, int height)
+{
+	//	masks can be made from any thread during a parallel update
+	static std::mutex mutex;
+	static std::map<std::pair<int, int>, std::weak_ptr<const ShapeData>> cache;
+	std::lock_guard<std::mutex> lock(mutex);
+	std::weak_ptr<const ShapeData>& cached = cache[std::make_pair(width, height)];
+	Shape shape = cached.lock();
+	if (!shape)
+	{
+		shape = makeShape({
+			sf::Vector2f(0, 0),
+			sf::Vector2f(width, 0),
+			sf::Vector2f(width, height),
+			sf::Vector2f(0, height)
+		});
+		cached = shape;
+	}
+	return shape;
+}
+
+void PolygonMask::computeAxes(const sf::Vector2f *points, std::size_t count, std::vector<sf::Vector2f>& axes)
+{
+	axes.clear();
+	const int size = count;
+	for (int i = 0; i < size; ++i)
+	{
+		const sf::Vector2f edge = points[(i + 1) % size] - points[i];
+		const float edgeLength = length(edge);
+		if (edgeLength == 0.f)
+			continue;
+		const sf::Vector2f axis(-edge.y / edgeLength, edge.x / edgeLength);
+		//	opposite edges of a rectangle (or any parallel ones) give the same projections
+		bool duplicate = false;
+		for (const sf::Vector2f& existing : axes)
+		{
+			if (std::abs(axis.x * existing.y - axis.y * existing.x) < 0.0001f)
+			{
+				duplicate = true;
+				break;
+			}
+		}
+		if (!duplicate)
+			axes.push_back(axis);
+	}
 }
 
 DetailedMask::MaskRef PolygonMask::clone() const
@@ -109,6 +218,22 @@ DetailedMask::MaskRef PolygonMask::clone() const
 	return DetailedMask::MaskRef(new PolygonMask(*this));
 }
 
+void* PolygonMask::operator new(std::size_t size)
+{
+	//	anything derived from PolygonMask won't fit the pool's blocks
+	if (size != sizeof(PolygonMask))
+		return ::operator new(size);
+	return maskPool().allocate();
+}
+
+void PolygonMask::operator delete(void *object, std::size_t size)
+{
+	if (size != sizeof(PolygonMask))
+		::operator delete(object);
+	else
+		EntityPool::release(object);
+}
+
 #ifdef JE_DEBUG
 void PolygonMask::draw(sf::RenderTarget& target, sf::RenderStates states) const
 {
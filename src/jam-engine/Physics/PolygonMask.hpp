@@ -1,6 +1,8 @@
 #ifndef JE_POLYGON_MASK_HPP
 #define JE_POLYGON_MASK_HPP
 
+#include <cstddef>
+#include <memory>
 #include <vector>
 
 #ifdef JE_DEBUG
@@ -12,67 +14,89 @@
 #include "jam-engine/Physics/DetailedMask.hpp"
 #include <initializer_list>
 
+#ifndef JE_POLYGON_INLINE_POINTS
+	//	polygons with up to this many points keep their transformed points inside the mask rather than allocating them
+	#define JE_POLYGON_INLINE_POINTS 4
+#endif
+
 namespace je
 {
 
 class CircleMask;
 
+class PixelMask;
+
 class PolygonMask : public DetailedMask
 {
 public:
+	//!The untransformed points of a polygon and its edge normals. Immutable, so every copy of a mask shares the same one
+	struct ShapeData
+	{
+		std::vector<sf::Vector2f> points;
+		//!See getAxes()
+		std::vector<sf::Vector2f> axes;
+	};
+
+	typedef std::shared_ptr<const ShapeData> Shape;
+
+	/**
+	 * @param points The untransformed points of a convex polygon
+	 * @return A Shape for any number of masks to share
+	 */
+	static Shape makeShape(std::vector<sf::Vector2f> points);
+
 	PolygonMask(const std::initializer_list<sf::Vector2f>& container)
-		:DetailedMask(Type::Polygon)
-		,points()
-		,pointsOriginal()
-#ifdef JE_DEBUG
-		,debugDrawPoints(sf::PrimitiveType::LinesStrip)
-#endif
+		:PolygonMask(makeShape(container))
 	{
-		bool first = true;
-		sf::Vector2f min;
-		//for (const auto& p : container)
-		//{
-		//	if (first)
-		//	{
-		//		min = p;
-		//		first = false;
-		//	}
-		//	else
-		//	{
-		//		if (p.x < min.x)
-		//			min.x = p.x;
-		//		if (p.y < min.y)
-		//			min.y = p.y;
-		//	}
-		//}
-		for (auto p : container)
-		{
-			p -= min;
-			points.push_back(p);
-			pointsOriginal.push_back(p);
-#ifdef JE_DEBUG
-			debugDrawPoints.append(sf::Vertex(p, sf::Color::Blue));
-#endif
-		}
-#ifdef JE_DEBUG
-		debugDrawPoints.append(debugDrawPoints[0]);
-#endif
 	}
 
+	/**
+	 * An axis aligned rectangle from (0, 0) to (width, height). Rectangles of the same size share a Shape.
+	 */
 	PolygonMask(int width, int height);
 
+	/**
+	 * @param shape The untransformed points, which will be shared rather than copied
+	 */
+	PolygonMask(Shape shape);
+
+	//!Shares other's Shape, but starts out untransformed
 	PolygonMask(const PolygonMask& other);
 
+	inline const Shape& getShape() const;
+
 	void projectAgainstHyerplane(double& min, double& max, double angle) const;
 
+	/**
+	 * Projects the polygon onto an axis
+	 * @param axis A unit vector
+	 * @param min Set to the lowest projection
+	 * @param max Set to the highest projection
+	 */
+	inline void project(const sf::Vector2f& axis, float& min, float& max) const;
+
+	/**
+	 * @return The unit normals of the edges without any parallel duplicates, which are all
+	 * the separating axes this polygon contributes to SAT. A rectangle has 2. They're the Shape's
+	 * own unless the mask is rotated or scaled, since moving it doesn't change them.
+	 */
+	inline const std::vector<sf::Vector2f>& getAxes() const;
+
 	bool intersects(const DetailedMask& other) const override;
 
+	bool sweep(const DetailedMask& other, const sf::Vector2f& veloc, SweepHit& hit) const override;
+
 	void getAABB(int& minX, int& maxX, int& minY, int& maxY) const override;
 
 	void updateTransform(const sf::Transform& transform) override;
 
 	DetailedMask::MaskRef clone() const override;
 
+	//	a mask is made and freed with every Entity, so they come from a pool rather than the heap
+	static void* operator new(std::size_t size);
+
+	static void operator delete(void *object, std::size_t size);
+
 #ifdef JE_DEBUG
 	void draw(sf::RenderTarget& target, sf::RenderStates states) const override;
 
@@ -80,16 +104,121 @@ public:
 #endif
 
 private:
-	std::vector<sf::Vector2f> points;
-	std::vector<sf::Vector2f> pointsOriginal;
+	//!A polygon's transformed points, held inline unless there are more than JE_POLYGON_INLINE_POINTS
+	class Points
+	{
+	public:
+		//!Starts out as a copy of original
+		explicit Points(const std::vector<sf::Vector2f>& original);
+
+		inline std::size_t size() const;
+
+		inline sf::Vector2f& operator[](std::size_t index);
+
+		inline const sf::Vector2f& operator[](std::size_t index) const;
+
+		inline const sf::Vector2f& front() const;
+
+		inline const sf::Vector2f* begin() const;
+
+		inline const sf::Vector2f* end() const;
+
+		inline const sf::Vector2f* data() const;
+
+	private:
+		sf::Vector2f inlinePoints[JE_POLYGON_INLINE_POINTS];
+		//!Only used when the points don't fit in inlinePoints
+		std::vector<sf::Vector2f> morePoints;
+		std::size_t count;
+	};
+
+	//!Works out the axes of a polygon with the given points
+	static void computeAxes(const sf::Vector2f *points, std::size_t count, std::vector<sf::Vector2f>& axes);
+
+	/**
+	 * @return The shared Shape of a width x height rectangle, made on first use. The cache only
+	 * holds weak references, so a size nothing uses any more is freed.
+	 */
+	static Shape rectangle(int width, int height);
+
+	//!The points after the last updateTransform(), which is all a mask keeps to itself unless it's rotated or scaled
+	Points points;
+	Shape shape;
+	//!Only used while ownAxes, so that masks that are only ever moved don't allocate them
+	std::vector<sf::Vector2f> axes;
+	//!Whether the last transform rotated or scaled the mask, so the Shape's axes don't fit it
+	bool ownAxes;
 #ifdef JE_DEBUG
 	sf::VertexArray debugDrawPoints;
 #endif
 
 	friend bool intersectsPolygonOnPolygon(const PolygonMask&, const PolygonMask&);
 	friend bool intersectsPolygonOnCircle(const PolygonMask&, const CircleMask&);
+	friend bool intersectsPolygonOnPixel(const PolygonMask&, const PixelMask&);
+	friend bool sweepPolygonOnPolygon(const PolygonMask&, const PolygonMask&, const sf::Vector2f&, DetailedMask::SweepHit&);
+	friend bool sweepCircleOnPolygon(const CircleMask&, const PolygonMask&, const sf::Vector2f&, DetailedMask::SweepHit&);
 };
 
+/*		inline implementation		*/
+void PolygonMask::project(const sf::Vector2f& axis, float& min, float& max) const
+{
+	min = max = points.front().x * axis.x + points.front().y * axis.y;
+	//	skip the first point since we already did that
+	for (const sf::Vector2f *it = points.begin() + 1, *end = points.end(); it != end; ++it)
+	{
+		const float projection = it->x * axis.x + it->y * axis.y;
+		if (projection < min)
+			min = projection;
+		else if (projection > max)
+			max = projection;
+	}
+}
+
+const std::vector<sf::Vector2f>& PolygonMask::getAxes() const
+{
+	return ownAxes ? axes : shape->axes;
+}
+
+const PolygonMask::Shape& PolygonMask::getShape() const
+{
+	return shape;
+}
+
+std::size_t PolygonMask::Points::size() const
+{
+	return count;
+}
+
+sf::Vector2f& PolygonMask::Points::operator[](std::size_t index)
+{
+	return count <= JE_POLYGON_INLINE_POINTS ? inlinePoints[index] : morePoints[index];
+}
+
+const sf::Vector2f& PolygonMask::Points::operator[](std::size_t index) const
+{
+	return count <= JE_POLYGON_INLINE_POINTS ? inlinePoints[index] : morePoints[index];
+}
+
+const sf::Vector2f& PolygonMask::Points::front() const
+{
+	return *data();
+}
+
+const sf::Vector2f* PolygonMask::Points::begin() const
+{
+	return data();
+}
+
+const sf::Vector2f* PolygonMask::Points::end() const
+{
+	return data() + count;
+}
+
+const sf::Vector2f* PolygonMask::Points::data() const
+{
+	return count <= JE_POLYGON_INLINE_POINTS ? inlinePoints : morePoints.data();
+}
+
 }
 
 #endif
@@ -0,0 +1,338 @@
+#include "jam-engine/Physics/SpatialHash.hpp"
+
+#include <cmath>
+#include <limits>
+
+//	define JE_NO_SIMD to force the scalar scan()
+#ifndef JE_NO_SIMD
+	#if defined(__AVX2__)
+		#include <immintrin.h>
+		#define JE_SPATIAL_HASH_AVX2
+	#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+		#include <emmintrin.h>
+		#define JE_SPATIAL_HASH_SSE2
+	#endif
+#endif
+
+#include "jam-engine/Core/Entity.hpp"
+#include "jam-engine/Utility/Assert.hpp"
+#include "jam-engine/Utility/Math.hpp"
+
+namespace je
+{
+
+//	roughly how many Entities scan() gets through in the time query() takes to look up one cell
+static const int scanEntitiesPerCell = 32;
+
+//	division that rounds towards negative infinity so negative coordinates get their own cells
+static inline int floorDiv(int n, int d)
+{
+	return n >= 0 ? n / d : -((-n + d - 1) / d);
+}
+
+SpatialHash::SpatialHash(int cellSize, int maxCellsPerEntity)
+	:cellSize(cellSize)
+	,maxCellsPerEntity(maxCellsPerEntity)
+	,cells()
+	,oversized()
+{
+	JE_ASSERT(cellSize > 0);
+}
+
+SpatialHash::~SpatialHash()
+{
+	this->clear();
+}
+
+void SpatialHash::insert(Entity& entity)
+{
+	JE_ASSERT(entity.broadphase == nullptr);
+	const sf::Rect<int> aabb = entity.getMask().getAABB();
+	const sf::Rect<int> range = cellsCovering(aabb.left, aabb.left + aabb.width, aabb.top, aabb.top + aabb.height);
+	entity.broadphase = this;
+	entity.broadphaseCells = range;
+	entity.broadphaseIndex = members.size();
+	members.push_back(&entity);
+	minX.push_back(0);
+	maxX.push_back(0);
+	minY.push_back(0);
+	maxY.push_back(0);
+	setBounds(entity.broadphaseIndex, aabb);
+	addToCells(entity, range);
+}
+
+void SpatialHash::update(Entity& entity)
+{
+	JE_ASSERT(entity.broadphase == this);
+	const sf::Rect<int> aabb = entity.getMask().getAABB();
+	const sf::Rect<int> range = cellsCovering(aabb.left, aabb.left + aabb.width, aabb.top, aabb.top + aabb.height);
+	setBounds(entity.broadphaseIndex, aabb);
+	if (range != entity.broadphaseCells)
+	{
+		removeFromCells(entity, entity.broadphaseCells);
+		entity.broadphaseCells = range;
+		addToCells(entity, range);
+	}
+}
+
+void SpatialHash::remove(Entity& entity)
+{
+	JE_ASSERT(entity.broadphase == this);
+	removeFromCells(entity, entity.broadphaseCells);
+	//	swap the last Entity into the hole
+	const unsigned int index = entity.broadphaseIndex;
+	Entity *last = members.back();
+	members[index] = last;
+	minX[index] = minX.back();
+	maxX[index] = maxX.back();
+	minY[index] = minY.back();
+	maxY[index] = maxY.back();
+	last->broadphaseIndex = index;
+	members.pop_back();
+	minX.pop_back();
+	maxX.pop_back();
+	minY.pop_back();
+	maxY.pop_back();
+	entity.broadphase = nullptr;
+}
+
+void SpatialHash::clear()
+{
+	for (auto& p : cells)
+		for (Entity *entity : p.second)
+			entity->broadphase = nullptr;
+	for (Entity *entity : oversized)
+		entity->broadphase = nullptr;
+	cells.clear();
+	oversized.clear();
+	members.clear();
+	minX.clear();
+	maxX.clear();
+	minY.clear();
+	maxY.clear();
+}
+
+void SpatialHash::query(const sf::Rect<int>& bBox, std::vector<Entity*>& results) const
+{
+	for (Entity *entity : oversized)
+		results.push_back(entity);
+
+	const sf::Rect<int> range = cellsCovering(bBox.left, bBox.left + bBox.width, bBox.top, bBox.top + bBox.height);
+	const auto end = cells.end();
+	for (int y = range.top; y < range.top + range.height; ++y)
+	{
+		for (int x = range.left; x < range.left + range.width; ++x)
+		{
+			auto it = cells.find(key(x, y));
+			if (it == end)
+				continue;
+			for (Entity *entity : it->second)
+			{
+				//	an Entity covering several cells is only reported from the first cell that the
+				//	query shares with it, so no visited-marking is needed to avoid duplicates
+				const sf::Rect<int>& e = entity->broadphaseCells;
+				if (x == max(e.left, range.left) && y == max(e.top, range.top))
+					results.push_back(entity);
+			}
+		}
+	}
+}
+
+void SpatialHash::scan(const sf::Rect<int>& bBox, std::vector<Entity*>& results) const
+{
+	//	the same comparisons as CollisionMask::intersects(const sf::Rect<int>&)
+	const int left = bBox.left, right = bBox.left + bBox.width;
+	const int top = bBox.top, bottom = bBox.top + bBox.height;
+	const std::size_t count = members.size();
+	std::size_t i = 0;
+#if defined(JE_SPATIAL_HASH_AVX2)
+	const __m256i lefts = _mm256_set1_epi32(left), rights = _mm256_set1_epi32(right);
+	const __m256i tops = _mm256_set1_epi32(top), bottoms = _mm256_set1_epi32(bottom);
+	for (; i + 8 <= count; i += 8)
+	{
+		//	left < maxX && !(minX > right) && top < maxY && !(minY > bottom)
+		const __m256i inX = _mm256_andnot_si256(
+			_mm256_cmpgt_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(&minX[i])), rights),
+			_mm256_cmpgt_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(&maxX[i])), lefts));
+		const __m256i inY = _mm256_andnot_si256(
+			_mm256_cmpgt_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(&minY[i])), bottoms),
+			_mm256_cmpgt_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(&maxY[i])), tops));
+		//	one bit per lane, so a whole vector of misses is skipped with a single test
+		const int mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_and_si256(inX, inY)));
+		if (mask == 0)
+			continue;
+		for (int lane = 0; lane < 8; ++lane)
+			if (mask & (1 << lane))
+				results.push_back(members[i + lane]);
+	}
+#elif defined(JE_SPATIAL_HASH_SSE2)
+	const __m128i lefts = _mm_set1_epi32(left), rights = _mm_set1_epi32(right);
+	const __m128i tops = _mm_set1_epi32(top), bottoms = _mm_set1_epi32(bottom);
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m128i inX = _mm_andnot_si128(
+			_mm_cmpgt_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&minX[i])), rights),
+			_mm_cmpgt_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&maxX[i])), lefts));
+		const __m128i inY = _mm_andnot_si128(
+			_mm_cmpgt_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&minY[i])), bottoms),
+			_mm_cmpgt_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&maxY[i])), tops));
+		const int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_and_si128(inX, inY)));
+		if (mask == 0)
+			continue;
+		for (int lane = 0; lane < 4; ++lane)
+			if (mask & (1 << lane))
+				results.push_back(members[i + lane]);
+	}
+#endif
+	//	whatever didn't fill a whole vector (or everything, without SIMD)
+	for (; i < count; ++i)
+		if (left < maxX[i] && right >= minX[i] && top < maxY[i] && bottom >= minY[i])
+			results.push_back(members[i]);
+}
+
+bool SpatialHash::prefersScan(const sf::Rect<int>& bBox) const
+{
+	const sf::Rect<int> range = cellsCovering(bBox.left, bBox.left + bBox.width, bBox.top, bBox.top + bBox.height);
+	return static_cast<std::size_t>(range.width) * range.height * scanEntitiesPerCell >= members.size();
+}
+
+void SpatialHash::sweep(const sf::Rect<int>& bBox, const sf::Vector2f& veloc, const std::function<float(Entity&)>& visitor) const
+{
+	float best = 2.f;
+	for (Entity *entity : oversized)
+		best = visitor(*entity);
+
+	//	DDA: the sweep is split at every time the box's leading edges cross a cell boundary, and
+	//	each step only looks at the cells it covers that the previous steps didn't
+	const float stepX = veloc.x != 0.f ? cellSize / std::abs(veloc.x) : std::numeric_limits<float>::infinity();
+	const float stepY = veloc.y != 0.f ? cellSize / std::abs(veloc.y) : std::numeric_limits<float>::infinity();
+	float nextX = firstCrossing(bBox.left, bBox.left + bBox.width, veloc.x);
+	float nextY = firstCrossing(bBox.top, bBox.top + bBox.height, veloc.y);
+	sf::Rect<int> previous(0, 0, 0, 0);
+	const auto end = cells.end();
+	for (float start = 0.f; start <= 1.f && best > start; )
+	{
+		const float stop = min(min(nextX, nextY), 1.f);
+		//	the box's bounds over [start, stop]
+		const float dxStart = veloc.x * start, dxStop = veloc.x * stop;
+		const float dyStart = veloc.y * start, dyStop = veloc.y * stop;
+		const sf::Rect<int> range = cellsCovering(
+			std::floor(bBox.left + min(dxStart, dxStop)), std::floor(bBox.left + bBox.width + max(dxStart, dxStop)),
+			std::floor(bBox.top + min(dyStart, dyStop)), std::floor(bBox.top + bBox.height + max(dyStart, dyStop)));
+		for (int y = range.top; y < range.top + range.height; ++y)
+		{
+			for (int x = range.left; x < range.left + range.width; ++x)
+			{
+				if (previous.contains(x, y))
+					continue;
+				auto it = cells.find(key(x, y));
+				if (it == end)
+					continue;
+				for (Entity *entity : it->second)
+				{
+					//	the box moves monotonically, so an Entity seen in an earlier step overlaps the
+					//	previous step's cells. Otherwise report it from its first cell in this step only
+					const sf::Rect<int>& e = entity->broadphaseCells;
+					if (!previous.intersects(e) && x == max(e.left, range.left) && y == max(e.top, range.top))
+						best = visitor(*entity);
+				}
+			}
+		}
+		if (stop >= 1.f)
+			break;
+		previous = range;
+		start = stop;
+		if (nextX <= stop)
+			nextX += stepX;
+		if (nextY <= stop)
+			nextY += stepY;
+	}
+}
+
+int SpatialHash::getCellSize() const
+{
+	return cellSize;
+}
+
+/*		private			*/
+SpatialHash::Key SpatialHash::key(int x, int y)
+{
+	return (static_cast<Key>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(y);
+}
+
+sf::Rect<int> SpatialHash::cellsCovering(int minX, int maxX, int minY, int maxY) const
+{
+	const int left = floorDiv(minX, cellSize);
+	const int top = floorDiv(minY, cellSize);
+	//	max edges are inclusive to match CollisionMask::intersects()
+	return sf::Rect<int>(left, top, floorDiv(maxX, cellSize) - left + 1, floorDiv(maxY, cellSize) - top + 1);
+}
+
+void SpatialHash::setBounds(unsigned int index, const sf::Rect<int>& aabb)
+{
+	minX[index] = aabb.left;
+	maxX[index] = aabb.left + aabb.width;
+	minY[index] = aabb.top;
+	maxY[index] = aabb.top + aabb.height;
+}
+
+float SpatialHash::firstCrossing(int minEdge, int maxEdge, float speed) const
+{
+	if (speed > 0.f)
+		return ((floorDiv(maxEdge, cellSize) + 1) * cellSize - maxEdge) / speed;
+	if (speed < 0.f)
+		return (minEdge - floorDiv(minEdge, cellSize) * cellSize) / -speed;
+	return std::numeric_limits<float>::infinity();
+}
+
+void SpatialHash::addToCells(Entity& entity, const sf::Rect<int>& range)
+{
+	if (isOversized(range))
+	{
+		oversized.push_back(&entity);
+		return;
+	}
+	for (int y = range.top; y < range.top + range.height; ++y)
+		for (int x = range.left; x < range.left + range.width; ++x)
+			cells[key(x, y)].push_back(&entity);
+}
+
+void SpatialHash::removeFromCells(Entity& entity, const sf::Rect<int>& range)
+{
+	if (isOversized(range))
+	{
+		eraseFrom(oversized, &entity);
+		return;
+	}
+	for (int y = range.top; y < range.top + range.height; ++y)
+	{
+		for (int x = range.left; x < range.left + range.width; ++x)
+		{
+			auto it = cells.find(key(x, y));
+			JE_ASSERT(it != cells.end());
+			eraseFrom(it->second, &entity);
+			//	empty cells are kept around so Entities moving back and forth don't reallocate them
+		}
+	}
+}
+
+bool SpatialHash::isOversized(const sf::Rect<int>& range) const
+{
+	return range.width * range.height > maxCellsPerEntity;
+}
+
+void SpatialHash::eraseFrom(std::vector<Entity*>& vec, Entity *entity)
+{
+	for (Entity*& e : vec)
+	{
+		if (e == entity)
+		{
+			e = vec.back();
+			vec.pop_back();
+			return;
+		}
+	}
+	JE_ASSERT(false);
+}
+
+} // je
@@ -0,0 +1,118 @@
+#ifndef JE_SPATIAL_HASH_HPP
+#define JE_SPATIAL_HASH_HPP
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include <SFML/Graphics/Rect.hpp>
+#include <SFML/System/Vector2.hpp>
+
+namespace je
+{
+
+class Entity;
+
+/**
+ * Uniform grid broadphase keyed on the CollisionMask AABBs of the Entities inside it.
+ * Cells are hashed so the grid is unbounded and only occupied cells use memory.
+ * The AABBs are also mirrored into flat arrays so that big queries can test them all
+ * several at a time with SIMD instead of walking lots of cells.
+ */
+class SpatialHash
+{
+public:
+	/**
+	 * @param cellSize The width/height in pixels of each cell
+	 * @param maxCellsPerEntity Entities spanning more cells than this are kept in a separate list that every query checks
+	 */
+	SpatialHash(int cellSize, int maxCellsPerEntity = 256);
+
+	SpatialHash(const SpatialHash&) = delete;
+
+	SpatialHash& operator=(const SpatialHash&) = delete;
+
+	~SpatialHash();
+
+	/**
+	 * Registers the Entity using its current mask bounds
+	 */
+	void insert(Entity& entity);
+
+	/**
+	 * Moves the Entity to the cells its current mask bounds cover. Only touches the cells if they changed.
+	 */
+	void update(Entity& entity);
+
+	void remove(Entity& entity);
+
+	void clear();
+
+	/**
+	 * Appends every Entity whose cells overlap the given box. Each Entity is appended at most once.
+	 * @param bBox The area to query
+	 * @param results Where to append the candidates (not cleared)
+	 */
+	void query(const sf::Rect<int>& bBox, std::vector<Entity*>& results) const;
+
+	/**
+	 * Appends every Entity whose bounds overlap the given box, by the same test as
+	 * CollisionMask::intersects(const sf::Rect<int>&), checking every Entity in the hash with SIMD.
+	 * @param bBox The area to query
+	 * @param results Where to append the Entities (not cleared)
+	 */
+	void scan(const sf::Rect<int>& bBox, std::vector<Entity*>& results) const;
+
+	/**
+	 * @return Whether scan() should be cheaper than query() for a box this big, given how many Entities there are
+	 */
+	bool prefersScan(const sf::Rect<int>& bBox) const;
+
+	/**
+	 * Walks the cells bBox passes through as it moves along veloc, nearest first, visiting each
+	 * Entity in them once. Stops as soon as every cell left is entered later than the earliest
+	 * hit found so far, so a cast that hits something close by never looks further along.
+	 * @param bBox The area at the start of the sweep
+	 * @param veloc How far bBox moves
+	 * @param visitor Called with each candidate, returning the earliest hit time found so far (as a
+	 * fraction of veloc), or anything greater than 1 for no hit yet
+	 */
+	void sweep(const sf::Rect<int>& bBox, const sf::Vector2f& veloc, const std::function<float(Entity&)>& visitor) const;
+
+	int getCellSize() const;
+
+private:
+	typedef uint64_t Key;
+
+	static Key key(int x, int y);
+
+	sf::Rect<int> cellsCovering(int minX, int maxX, int minY, int maxY) const;
+
+	/**
+	 * @return When the leading edge of a box moving at speed along one axis first crosses into a new cell
+	 */
+	float firstCrossing(int minEdge, int maxEdge, float speed) const;
+
+	void setBounds(unsigned int index, const sf::Rect<int>& aabb);
+
+	void addToCells(Entity& entity, const sf::Rect<int>& cells);
+
+	void removeFromCells(Entity& entity, const sf::Rect<int>& cells);
+
+	bool isOversized(const sf::Rect<int>& cells) const;
+
+	static void eraseFrom(std::vector<Entity*>& vec, Entity *entity);
+
+	int cellSize;
+	int maxCellsPerEntity;
+	std::unordered_map<Key, std::vector<Entity*>> cells;
+	std::vector<Entity*> oversized;
+	//!Every Entity in the hash, with their AABBs as structure-of-arrays in the same order
+	std::vector<Entity*> members;
+	std::vector<int> minX, maxX, minY, maxY;
+};
+
+} // je
+
+#endif // JE_SPATIAL_HASH_HPP
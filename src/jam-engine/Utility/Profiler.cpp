@@ -0,0 +1,319 @@
+#include "jam-engine/Utility/Profiler.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <SFML/Graphics/RectangleShape.hpp>
+#include <SFML/Graphics/RenderTarget.hpp>
+#include <SFML/Graphics/Text.hpp>
+#include <SFML/Graphics/VertexArray.hpp>
+
+#include "jam-engine/Utility/Assert.hpp"
+
+#ifndef JE_PROFILER_HISTORY
+	#define JE_PROFILER_HISTORY 300
+#endif
+
+namespace je
+{
+
+namespace
+{
+
+struct Event
+{
+	Profiler::Zone zone;
+	unsigned int thread;
+	//	both in microseconds, start being since the profiler started
+	double start;
+	double duration;
+};
+
+struct Frame
+{
+	double start;
+	double duration;
+	std::vector<Event> events;
+};
+
+struct State
+{
+	State()
+		:epoch(std::chrono::steady_clock::now())
+		,frames(JE_PROFILER_HISTORY)
+		,newest(0)
+		,count(0)
+		,current()
+	{
+		current.start = 0.0;
+	}
+
+	std::mutex mutex;
+	std::chrono::steady_clock::time_point epoch;
+	//	a deque so that references handed out by getName() stay valid as more zones are made
+	std::deque<std::string> names;
+	std::unordered_map<std::string, Profiler::Zone> ids;
+	std::vector<Frame> frames;
+	std::size_t newest;
+	std::size_t count;
+	Frame current;
+};
+
+//	function-local so that zones can be made during static initialization elsewhere
+State& state()
+{
+	static State state;
+	return state;
+}
+
+double microseconds(std::chrono::steady_clock::time_point time)
+{
+	return std::chrono::duration<double, std::micro>(time - state().epoch).count();
+}
+
+//	numbers the threads in the order they first record anything, which is all a trace needs
+unsigned int threadIndex()
+{
+	static std::atomic<unsigned int> next(0);
+	static thread_local const unsigned int index = next++;
+	return index;
+}
+
+//	assumes the mutex is held
+const Frame* frameAgo(const State& s, std::size_t framesAgo)
+{
+	if (framesAgo >= s.count)
+		return nullptr;
+	return &s.frames[(s.newest + s.frames.size() - framesAgo) % s.frames.size()];
+}
+
+sf::Color zoneColor(Profiler::Zone zone)
+{
+	static const sf::Color palette[] = {
+		sf::Color(230, 25, 75),
+		sf::Color(60, 180, 75),
+		sf::Color(255, 225, 25),
+		sf::Color(0, 130, 200),
+		sf::Color(245, 130, 48),
+		sf::Color(145, 30, 180),
+		sf::Color(70, 240, 240),
+		sf::Color(240, 50, 230)
+	};
+	return palette[zone % (sizeof(palette) / sizeof(palette[0]))];
+}
+
+void writeEscaped(std::ofstream& out, const std::string& str)
+{
+	for (char c : str)
+	{
+		if (c == '"' || c == '\\')
+			out << '\\';
+		out << c;
+	}
+}
+
+} // anonymous
+
+Profiler::Scope::Scope(Zone zone)
+	:zone(zone)
+	,start(std::chrono::steady_clock::now())
+{
+}
+
+Profiler::Scope::~Scope()
+{
+	const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+	Event event;
+	event.zone = zone;
+	event.thread = threadIndex();
+	event.start = microseconds(start);
+	event.duration = std::chrono::duration<double, std::micro>(end - start).count();
+	State& s = state();
+	//	zones can finish on worker threads during a parallel update
+	std::lock_guard<std::mutex> lock(s.mutex);
+	s.current.events.push_back(event);
+}
+
+Profiler::Zone Profiler::zone(const std::string& name)
+{
+	State& s = state();
+	std::lock_guard<std::mutex> lock(s.mutex);
+	auto it = s.ids.find(name);
+	if (it != s.ids.end())
+		return it->second;
+	const Zone zone = s.names.size();
+	s.names.push_back(name);
+	s.ids[name] = zone;
+	return zone;
+}
+
+const std::string& Profiler::getName(Zone zone)
+{
+	State& s = state();
+	std::lock_guard<std::mutex> lock(s.mutex);
+	JE_ASSERT(zone < s.names.size());
+	return s.names[zone];
+}
+
+void Profiler::beginFrame()
+{
+	State& s = state();
+	std::lock_guard<std::mutex> lock(s.mutex);
+	s.current.start = microseconds(std::chrono::steady_clock::now());
+}
+
+void Profiler::endFrame()
+{
+	State& s = state();
+	std::lock_guard<std::mutex> lock(s.mutex);
+	s.current.duration = microseconds(std::chrono::steady_clock::now()) - s.current.start;
+	s.newest = s.count == 0 ? 0 : (s.newest + 1) % s.frames.size();
+	if (s.count < s.frames.size())
+		++s.count;
+	//	swapping hands the recycled frame's event storage to the next frame
+	std::swap(s.frames[s.newest], s.current);
+	s.current.events.clear();
+}
+
+std::size_t Profiler::getFrameCount()
+{
+	State& s = state();
+	std::lock_guard<std::mutex> lock(s.mutex);
+	return s.count;
+}
+
+double Profiler::getFrameTime(std::size_t framesAgo)
+{
+	State& s = state();
+	std::lock_guard<std::mutex> lock(s.mutex);
+	const Frame *frame = frameAgo(s, framesAgo);
+	return frame ? frame->duration / 1000.0 : 0.0;
+}
+
+double Profiler::getZoneTime(Zone zone, std::size_t framesAgo)
+{
+	State& s = state();
+	std::lock_guard<std::mutex> lock(s.mutex);
+	const Frame *frame = frameAgo(s, framesAgo);
+	double total = 0.0;
+	if (frame)
+		for (const Event& event : frame->events)
+			if (event.zone == zone)
+				total += event.duration;
+	return total / 1000.0;
+}
+
+void Profiler::drawOverlay(sf::RenderTarget& target, const sf::Font *font)
+{
+	//	a bar this long is 1/30th of a second
+	const float barScale = 300.f / 33.3f;
+	const float rowHeight = 14.f;
+	const std::size_t averaged = 60;
+	const float left = 8.f, top = 8.f;
+
+	State& s = state();
+	std::vector<double> totals;
+	std::vector<float> history;
+	{
+		std::lock_guard<std::mutex> lock(s.mutex);
+		totals.assign(s.names.size(), 0.0);
+		const std::size_t frames = s.count < averaged ? s.count : averaged;
+		for (std::size_t i = 0; i < frames; ++i)
+			for (const Event& event : frameAgo(s, i)->events)
+				totals[event.zone] += event.duration / 1000.0 / frames;
+		for (std::size_t i = s.count; i > 0; --i)
+			history.push_back(frameAgo(s, i - 1)->duration / 1000.0);
+	}
+
+	//	frame times, oldest on the left, with a line at 60fps
+	const float graphHeight = 60.f;
+	sf::RectangleShape background(sf::Vector2f(s.frames.size(), graphHeight));
+	background.setPosition(left, top);
+	background.setFillColor(sf::Color(0, 0, 0, 160));
+	target.draw(background);
+	sf::VertexArray graph(sf::PrimitiveType::Lines);
+	for (std::size_t i = 0; i < history.size(); ++i)
+	{
+		const float height = history[i] * graphHeight / 33.3f < graphHeight ? history[i] * graphHeight / 33.3f : graphHeight;
+		const sf::Color color = history[i] > 16.7 ? sf::Color::Red : sf::Color::Green;
+		graph.append(sf::Vertex(sf::Vector2f(left + i, top + graphHeight), color));
+		graph.append(sf::Vertex(sf::Vector2f(left + i, top + graphHeight - height), color));
+	}
+	graph.append(sf::Vertex(sf::Vector2f(left, top + graphHeight / 2.f), sf::Color::White));
+	graph.append(sf::Vertex(sf::Vector2f(left + s.frames.size(), top + graphHeight / 2.f), sf::Color::White));
+	target.draw(graph);
+
+	//	then a bar per zone that did anything recently
+	float y = top + graphHeight + 4.f;
+	sf::RectangleShape bar;
+	sf::Text label;
+	if (font)
+	{
+		label.setFont(*font);
+		label.setCharacterSize(rowHeight - 2);
+		label.setColor(sf::Color::White);
+	}
+	for (Zone zone = 0; zone < totals.size(); ++zone)
+	{
+		if (totals[zone] <= 0.0)
+			continue;
+		bar.setPosition(left, y);
+		bar.setSize(sf::Vector2f(totals[zone] * barScale + 1.f, rowHeight - 2.f));
+		bar.setFillColor(zoneColor(zone));
+		target.draw(bar);
+		if (font)
+		{
+			char time[32];
+			std::snprintf(time, sizeof(time), " %.3fms", totals[zone]);
+			label.setString(getName(zone) + time);
+			label.setPosition(left + totals[zone] * barScale + 4.f, y - 2.f);
+			target.draw(label);
+		}
+		y += rowHeight;
+	}
+}
+
+bool Profiler::writeChromeTrace(const std::string& filename)
+{
+	std::ofstream out(filename.c_str());
+	if (!out)
+		return false;
+	State& s = state();
+	std::lock_guard<std::mutex> lock(s.mutex);
+	//	timestamps are in microseconds from when the profiler started, so keep the fractions
+	out << std::fixed;
+	out.precision(3);
+	out << "{\"traceEvents\":[";
+	bool first = true;
+	for (std::size_t i = s.count; i > 0; --i)
+	{
+		const Frame& frame = *frameAgo(s, i - 1);
+		//	complete ("X") events nest by time, so the frames go in their own process above the zones
+		out << (first ? "\n" : ",\n") << "{\"name\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":0,\"ts\":" << frame.start << ",\"dur\":" << frame.duration << "}";
+		first = false;
+		for (const Event& event : frame.events)
+		{
+			out << ",\n{\"name\":\"";
+			writeEscaped(out, s.names[event.zone]);
+			out << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << event.thread << ",\"ts\":" << event.start << ",\"dur\":" << event.duration << "}";
+		}
+	}
+	out << "\n]}\n";
+	return static_cast<bool>(out);
+}
+
+void Profiler::clear()
+{
+	State& s = state();
+	std::lock_guard<std::mutex> lock(s.mutex);
+	s.count = 0;
+	s.newest = 0;
+	s.current.events.clear();
+}
+
+} // je
@@ -0,0 +1,113 @@
+#ifndef JE_PROFILER_HPP
+#define JE_PROFILER_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+namespace sf
+{
+class Font;
+class RenderTarget;
+}
+
+namespace je
+{
+
+/**
+ * Frame profiler made of named zones timed by Profiler::Scope. Every zone that finishes during a
+ * frame is kept with that frame in a ring buffer of the last JE_PROFILER_HISTORY frames, which can
+ * be drawn as an overlay or written out as a Chrome trace (chrome://tracing) to look at later.
+ *
+ * The engine's own zones use JE_PROFILE_ZONE, which compiles to nothing unless JE_PROFILE is defined.
+ */
+class Profiler
+{
+public:
+	typedef unsigned int Zone;
+
+	//!Times from its construction to the end of its scope and records it as a zone
+	class Scope
+	{
+	public:
+		explicit Scope(Zone zone);
+
+		Scope(const Scope&) = delete;
+
+		Scope& operator=(const Scope&) = delete;
+
+		~Scope();
+
+	private:
+		Zone zone;
+		std::chrono::steady_clock::time_point start;
+	};
+
+	/**
+	 * @param name What the zone is shown as
+	 * @return The zone with that name, which is made the first time it's asked for
+	 */
+	static Zone zone(const std::string& name);
+
+	static const std::string& getName(Zone zone);
+
+	/**
+	 * Starts a new frame. Game calls this and endFrame() itself when built with JE_PROFILE.
+	 */
+	static void beginFrame();
+
+	//!Files everything recorded since beginFrame() into the ring buffer
+	static void endFrame();
+
+	/**
+	 * @return How many frames are in the ring buffer
+	 */
+	static std::size_t getFrameCount();
+
+	/**
+	 * @param framesAgo 0 for the last finished frame, 1 for the one before that, etc.
+	 * @return How long the frame took in milliseconds
+	 */
+	static double getFrameTime(std::size_t framesAgo = 0);
+
+	/**
+	 * @param framesAgo 0 for the last finished frame, 1 for the one before that, etc.
+	 * @return The total milliseconds spent in zone during the frame, across every thread
+	 */
+	static double getZoneTime(Zone zone, std::size_t framesAgo = 0);
+
+	/**
+	 * Draws each zone's time averaged over the last second or so as a bar, under a graph of
+	 * the recent frame times. Uses the target's current view.
+	 * @param font Used to label the bars if there is one
+	 */
+	static void drawOverlay(sf::RenderTarget& target, const sf::Font *font = nullptr);
+
+	/**
+	 * Writes every frame in the ring buffer in the Chrome trace event format
+	 * @return false if the file couldn't be written
+	 */
+	static bool writeChromeTrace(const std::string& filename);
+
+	//!Throws away the recorded frames, but not the zones
+	static void clear();
+};
+
+} // je
+
+#ifdef JE_PROFILE
+	#define JE_PROFILE_CONCAT_IMPL(a, b) a##b
+	#define JE_PROFILE_CONCAT(a, b) JE_PROFILE_CONCAT_IMPL(a, b)
+	//	times the rest of the enclosing block as the zone called name, which is only looked up once
+	#define JE_PROFILE_ZONE(name) \
+		static const je::Profiler::Zone JE_PROFILE_CONCAT(jeProfileZone, __LINE__) = je::Profiler::zone(name); \
+		const je::Profiler::Scope JE_PROFILE_CONCAT(jeProfileScope, __LINE__)(JE_PROFILE_CONCAT(jeProfileZone, __LINE__))
+	//	for names only known at runtime, so they're looked up every time
+	#define JE_PROFILE_ZONE_DYNAMIC(name) \
+		const je::Profiler::Scope JE_PROFILE_CONCAT(jeProfileScope, __LINE__)(je::Profiler::zone(name))
+#else
+	#define JE_PROFILE_ZONE(name)
+	#define JE_PROFILE_ZONE_DYNAMIC(name)
+#endif
+
+#endif // JE_PROFILER_HPP
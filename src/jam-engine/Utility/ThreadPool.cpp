@@ -0,0 +1,161 @@
+#include "jam-engine/Utility/ThreadPool.hpp"
+
+#include "jam-engine/Utility/Assert.hpp"
+
+namespace je
+{
+
+ThreadPool::ThreadPool(unsigned int workerCount)
+	:queues()
+	,workers()
+	,queued(0)
+	,nextQueue(0)
+	,stopping(false)
+{
+	JE_ASSERT(workerCount > 0);
+	for (unsigned int i = 0; i < workerCount; ++i)
+		queues.emplace_back(new Queue());
+	for (unsigned int i = 0; i < workerCount; ++i)
+		workers.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (std::thread& worker : workers)
+		worker.join();
+}
+
+void ThreadPool::submit(Task task)
+{
+	Queue& queue = *queues[nextQueue++ % queues.size()];
+	{
+		//	counted before it's published, since a worker can take it (and count it off) as soon as it's in the queue.
+		//	Taking the lock stops a worker missing it between checking queued and going to sleep
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		++queued;
+	}
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.tasks.push_back(std::move(task));
+	}
+	wake.notify_one();
+}
+
+void ThreadPool::parallelFor(std::size_t count, std::size_t grainSize, const std::function<void(std::size_t, std::size_t)>& body)
+{
+	if (count == 0)
+		return;
+	if (grainSize == 0)
+		grainSize = 1;
+	//	chunks are claimed from a shared cursor, so whichever thread is free takes the next one.
+	//	The job is shared with the helpers since a helper may only get to run after we've returned
+	struct Job
+	{
+		std::atomic<std::size_t> next;
+		std::atomic<std::size_t> done;
+		std::size_t count;
+		std::size_t grainSize;
+		std::size_t chunks;
+		const std::function<void(std::size_t, std::size_t)> *body;
+		std::mutex mutex;
+		std::condition_variable finished;
+	};
+	std::shared_ptr<Job> job = std::make_shared<Job>();
+	job->next = 0;
+	job->done = 0;
+	job->count = count;
+	job->grainSize = grainSize;
+	job->chunks = (count + grainSize - 1) / grainSize;
+	job->body = &body;
+
+	auto work = [](Job& job)
+	{
+		for (std::size_t chunk = job.next++; chunk < job.chunks; chunk = job.next++)
+		{
+			const std::size_t begin = chunk * job.grainSize;
+			const std::size_t end = begin + job.grainSize < job.count ? begin + job.grainSize : job.count;
+			(*job.body)(begin, end);
+			if (++job.done == job.chunks)
+			{
+				std::lock_guard<std::mutex> lock(job.mutex);
+				job.finished.notify_all();
+			}
+		}
+	};
+
+	const std::size_t helpers = job->chunks - 1 < workers.size() ? job->chunks - 1 : workers.size();
+	for (std::size_t i = 0; i < helpers; ++i)
+		this->submit([job, work]() { work(*job); });
+	work(*job);
+
+	std::unique_lock<std::mutex> lock(job->mutex);
+	job->finished.wait(lock, [&job]() { return job->done == job->chunks; });
+}
+
+unsigned int ThreadPool::getWorkerCount() const
+{
+	return workers.size();
+}
+
+unsigned int ThreadPool::defaultWorkerCount()
+{
+	const unsigned int hardware = std::thread::hardware_concurrency();
+	return hardware > 2 ? hardware - 1 : 1;
+}
+
+/*		private			*/
+bool ThreadPool::takeTask(unsigned int index, Task& task)
+{
+	{
+		Queue& own = *queues[index];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if (!own.tasks.empty())
+		{
+			task = std::move(own.tasks.back());
+			own.tasks.pop_back();
+			--queued;
+			return true;
+		}
+	}
+	for (std::size_t i = 1; i < queues.size(); ++i)
+	{
+		Queue& victim = *queues[(index + i) % queues.size()];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.tasks.empty())
+		{
+			task = std::move(victim.tasks.front());
+			victim.tasks.pop_front();
+			--queued;
+			return true;
+		}
+	}
+	return false;
+}
+
+void ThreadPool::workerLoop(unsigned int index)
+{
+	Task task;
+	for (;;)
+	{
+		if (takeTask(index, task))
+		{
+			task();
+			task = nullptr;
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		if (queued == 0)
+		{
+			if (stopping)
+				return;
+			wake.wait(lock, [this]() { return queued > 0 || stopping; });
+		}
+	}
+}
+
+} // je
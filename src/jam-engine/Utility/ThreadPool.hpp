@@ -0,0 +1,86 @@
+#ifndef JE_THREAD_POOL_HPP
+#define JE_THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace je
+{
+
+/**
+ * A pool of worker threads, each with its own task deque. Workers run their own tasks newest
+ * first and steal the oldest tasks from the other workers when they run out.
+ */
+class ThreadPool
+{
+public:
+	typedef std::function<void()> Task;
+
+	/**
+	 * @param workerCount How many threads to spawn
+	 */
+	explicit ThreadPool(unsigned int workerCount = defaultWorkerCount());
+
+	ThreadPool(const ThreadPool&) = delete;
+
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	/**
+	 * Finishes every queued task, then joins the workers
+	 */
+	~ThreadPool();
+
+	/**
+	 * Queues a task to be run on some worker at some point
+	 */
+	void submit(Task task);
+
+	/**
+	 * Runs body over [0, count) split into chunks of at most grainSize, using the workers as well
+	 * as the calling thread, and returns once every chunk has finished.
+	 * @param body Called as body(begin, end) for each chunk
+	 */
+	void parallelFor(std::size_t count, std::size_t grainSize, const std::function<void(std::size_t, std::size_t)>& body);
+
+	unsigned int getWorkerCount() const;
+
+	/**
+	 * @return One less than the number of hardware threads (the caller is usually busy too), but at least 1
+	 */
+	static unsigned int defaultWorkerCount();
+
+private:
+	struct Queue
+	{
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	/**
+	 * Pops the newest task from queue index or steals the oldest from any other queue
+	 */
+	bool takeTask(unsigned int index, Task& task);
+
+	void workerLoop(unsigned int index);
+
+	std::vector<std::unique_ptr<Queue>> queues;
+	std::vector<std::thread> workers;
+	std::mutex sleepMutex;
+	std::condition_variable wake;
+	//!Tasks submitted but not yet taken, so sleeping workers know whether to bother waking.
+	//!Counted up before a task is queued, so taking it can never count it off first
+	std::atomic<unsigned int> queued;
+	std::atomic<unsigned int> nextQueue;
+	bool stopping;
+};
+
+} // je
+
+#endif // JE_THREAD_POOL_HPP
@@ -63,6 +63,17 @@ inline float length(const VecType& vec)
 	return sqrt(vec.x * vec.x + vec.y * vec.y);
 }
 
+/**
+ * @param a First vector
+ * @param b Second vector
+ * @return The dot product of a and b
+ */
+template <typename VecType>
+inline float dot(const VecType& a, const VecType& b)
+{
+	return a.x * b.x + a.y * b.y;
+}
+
 /**
  * Calculates the distance between two points
  * @param a First point